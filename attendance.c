@@ -0,0 +1,4052 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#include "attendance.h"
+
+// One parsed roster line. `text` points into the mapped file: at the name for valid records and at
+// the whole line for invalid ones, which are kept so warnings come out in file order.
+typedef struct RosterRecord
+{
+    int id;
+    int valid;
+    const char *text;
+    int length;
+} RosterRecord;
+
+typedef struct RosterChunk
+{
+    const char *begin;
+    const char *end;
+    RosterRecord *records;
+    long count;
+    long capacity;
+    long validCount;
+} RosterChunk;
+
+typedef enum JournalOp
+{
+    JOURNAL_INSERT = 1, // id, name
+    JOURNAL_DELETE,     // id
+    JOURNAL_SUBJECT,    // subject index, name
+    JOURNAL_ROLL_CALL,  // subject index, day: every student starts the day absent
+    JOURNAL_MARK        // id, subject index, day, status
+} JournalOp;
+
+typedef struct JournalHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t checkpoint;
+} JournalHeader;
+
+// One attendance event from a scanner export; `day` is 0-based.
+typedef struct AttendanceTuple
+{
+    int id;
+    unsigned char subject;
+    unsigned char day;
+    signed char status;
+} AttendanceTuple;
+
+// The subjects an import may name: the store's own, then the new ones the file introduces, which
+// are only registered once every line of the file has parsed.
+typedef struct ImportSubjects
+{
+    char names[MAX_SUBJECTS][MAX_NAME_LEN];
+    int known; // the first `known` names are the store's subjects, with the same indexes
+    int count;
+} ImportSubjects;
+
+double nowSeconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int hashFunction(int id, int size)
+{
+    unsigned int h = (unsigned int) id;
+    h ^= h >> 16;
+    h *= 0x45d9f3bu;
+    h ^= h >> 16;
+    return (int) (h & (unsigned int) (size - 1));
+}
+
+// Once the table has TABLE_STRIPES buckets or more, a stripe is its bucket index masked down.
+static TableStripe *stripeFor(AttendanceStore *store, int id)
+{
+    return &store->tableStripes[hashFunction(id, TABLE_STRIPES) & store->stripeMask];
+}
+
+// Returns an empty store with no journal; recoverState attaches one.
+AttendanceStore *createStore()
+{
+    AttendanceStore *store = (AttendanceStore *) calloc(1, sizeof(AttendanceStore));
+    if (!store)
+    {
+        printf("Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    store->studentAllocator.slabUsed = SLAB_STUDENTS;
+    store->stripeMask = TABLE_STRIPES - 1;
+    for (int i = 0; i < TABLE_STRIPES; i++)
+    {
+        pthread_mutex_init(&store->tableStripes[i].lock, NULL);
+    }
+    pthread_mutex_init(&store->journal.lock, NULL);
+    pthread_mutex_init(&store->journal.writeLock, NULL);
+    pthread_cond_init(&store->journal.wake, NULL);
+    store->server.listenFd = -1;
+    store->server.epollFd = -1;
+    snprintf(store->server.reportDir, sizeof(store->server.reportDir), "%s", DEFAULT_REPORT_DIR);
+    pthread_mutex_init(&store->server.connectionsLock, NULL);
+    return store;
+}
+
+void lockAllStripes(AttendanceStore *store)
+{
+    for (int i = 0; i < TABLE_STRIPES; i++)
+    {
+        pthread_mutex_lock(&store->tableStripes[i].lock);
+    }
+}
+
+void unlockAllStripes(AttendanceStore *store)
+{
+    for (int i = TABLE_STRIPES - 1; i >= 0; i--)
+    {
+        pthread_mutex_unlock(&store->tableStripes[i].lock);
+    }
+}
+
+static void resetStripeCounters(AttendanceStore *store)
+{
+    for (int i = 0; i < TABLE_STRIPES; i++)
+    {
+        memset(store->tableStripes[i].subjectTotals, 0,
+               sizeof(store->tableStripes[i].subjectTotals));
+        memset(store->tableStripes[i].dayRecords, 0, sizeof(store->tableStripes[i].dayRecords));
+    }
+}
+
+static Student **allocateBuckets(int size)
+{
+    Student **buckets = (Student **) calloc(size, sizeof(Student *));
+    if (!buckets)
+    {
+        printf("Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    return buckets;
+}
+
+double hashTableLoadFactor(AttendanceStore *store)
+{
+    return store->hashTable.size ? (double) store->hashTable.count / store->hashTable.size : 0.0;
+}
+
+// Moves up to `steps` non-empty buckets from the old table into the new one.
+static void rehashStep(AttendanceStore *store, int steps)
+{
+    int emptyVisits = steps * 10;
+    while (store->hashTable.oldBuckets && steps > 0)
+    {
+        if (store->hashTable.rehashIndex >= store->hashTable.oldSize)
+        {
+            free(store->hashTable.oldBuckets);
+            store->hashTable.oldBuckets = NULL;
+            store->hashTable.oldSize = 0;
+            store->hashTable.rehashIndex = 0;
+            return;
+        }
+
+        Student *current = store->hashTable.oldBuckets[store->hashTable.rehashIndex];
+        if (current == NULL)
+        {
+            store->hashTable.rehashIndex++;
+            if (--emptyVisits == 0)
+            {
+                return;
+            }
+            continue;
+        }
+
+        while (current != NULL)
+        {
+            Student *next = current->next;
+            int index = hashFunction(current->id, store->hashTable.size);
+            current->next = store->hashTable.buckets[index];
+            store->hashTable.buckets[index] = current;
+            current = next;
+        }
+        store->hashTable.oldBuckets[store->hashTable.rehashIndex++] = NULL;
+        steps--;
+    }
+}
+
+static void resizeHashTable(AttendanceStore *store, int newSize)
+{
+    if (store->hashTable.oldBuckets)
+    {
+        rehashStep(store, store->hashTable.oldSize);
+    }
+    store->hashTable.oldBuckets = store->hashTable.buckets;
+    store->hashTable.oldSize = store->hashTable.size;
+    store->hashTable.rehashIndex = 0;
+    store->hashTable.size = newSize;
+    store->hashTable.buckets = allocateBuckets(store->hashTable.size);
+}
+
+static void growHashTable(AttendanceStore *store)
+{
+    resizeHashTable(store, store->hashTable.size * 2);
+}
+
+// Grows the table once so that `expected` more students fit without further resizes.
+static void reserveHashTable(AttendanceStore *store, long expected)
+{
+    long needed = (store->hashTable.count + expected) / MAX_LOAD_FACTOR + 1;
+    int size = store->hashTable.size ? store->hashTable.size : INITIAL_TABLE_SIZE;
+    while (size < needed && size < (1 << 30))
+    {
+        size *= 2;
+    }
+    if (!store->hashTable.buckets)
+    {
+        store->hashTable.size = size;
+        store->hashTable.buckets = allocateBuckets(size);
+    }
+    else if (size > store->hashTable.size)
+    {
+        resizeHashTable(store, size);
+    }
+}
+
+// Returns -1 when no attendance was taken, 0 for absent and 1 for present; `day` is 0-based.
+int getAttendance(const Student *student, int subjectIndex, int day)
+{
+    const AttendanceRecord *record = &student->subjects[subjectIndex];
+    uint32_t bit = 1u << day;
+    if (!(record->recorded & bit))
+    {
+        return -1;
+    }
+    return (record->present & bit) ? 1 : 0;
+}
+
+void setAttendance(AttendanceStore *store, Student *student, int subjectIndex, int day, int status)
+{
+    AttendanceRecord *record = &student->subjects[subjectIndex];
+    uint32_t bit = 1u << day;
+    int wasRecorded = (record->recorded & bit) != 0;
+    int wasPresent = (record->present & bit) != 0;
+    int recordedDelta = (status != -1) - wasRecorded;
+    int presentDelta = (status == 1) - wasPresent;
+
+    record->recorded = status == -1 ? record->recorded & ~bit : record->recorded | bit;
+    record->present = status == 1 ? record->present | bit : record->present & ~bit;
+
+    TableStripe *stripe = stripeFor(store, student->id);
+    student->totals.recorded += recordedDelta;
+    student->totals.present += presentDelta;
+    stripe->subjectTotals[subjectIndex].recorded += recordedDelta;
+    stripe->subjectTotals[subjectIndex].present += presentDelta;
+    stripe->dayRecords[subjectIndex][day] += recordedDelta;
+}
+
+// Adds (delta 1) or removes (delta -1) all of a student's marks from their stripe's counters.
+void accountStudent(AttendanceStore *store, const Student *student, int delta)
+{
+    TableStripe *stripe = stripeFor(store, student->id);
+    for (int i = 0; i < store->subjectCount; i++)
+    {
+        const AttendanceRecord *record = &student->subjects[i];
+        stripe->subjectTotals[i].recorded += delta * popcount32(record->recorded);
+        stripe->subjectTotals[i].present += delta * popcount32(record->present);
+        for (uint32_t days = record->recorded; days; days &= days - 1)
+        {
+            stripe->dayRecords[i][popcount32((days & -days) - 1)] += delta; // lowest day left
+        }
+    }
+}
+
+static long dayRecordCount(AttendanceStore *store, int subjectIndex, int day)
+{
+    long count = 0;
+    for (int i = 0; i < TABLE_STRIPES; i++)
+    {
+        count += store->tableStripes[i].dayRecords[subjectIndex][day];
+    }
+    return count;
+}
+
+int suffixSlot(int id)
+{
+    int slot = id % ID_SUFFIX_SLOTS;
+    return slot < 0 ? slot + ID_SUFFIX_SLOTS : slot;
+}
+
+static Student *allocateStudent(AttendanceStore *store)
+{
+    StudentAllocator *allocator = &store->studentAllocator;
+    Student *student;
+    if (allocator->freeList)
+    {
+        student = allocator->freeList;
+        allocator->freeList = student->next;
+        allocator->freeCount--;
+    }
+    else
+    {
+        if (allocator->slabUsed == SLAB_STUDENTS)
+        {
+            StudentSlab *slab = (StudentSlab *) malloc(sizeof(StudentSlab));
+            if (!slab)
+            {
+                printf("Error: Memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+            }
+            slab->nextSlab = allocator->slabs;
+            allocator->slabs = slab;
+            allocator->slabCount++;
+            allocator->slabUsed = 0;
+        }
+        student = &allocator->slabs->students[allocator->slabUsed++];
+    }
+    allocator->liveCount++;
+    allocator->totalAllocations++;
+    return student;
+}
+
+static void releaseStudent(AttendanceStore *store, Student *student)
+{
+    student->next = store->studentAllocator.freeList;
+    store->studentAllocator.freeList = student;
+    store->studentAllocator.freeCount++;
+    store->studentAllocator.liveCount--;
+}
+
+static void releaseAllStudents(AttendanceStore *store)
+{
+    StudentSlab *slab = store->studentAllocator.slabs;
+    while (slab != NULL)
+    {
+        StudentSlab *next = slab->nextSlab;
+        free(slab);
+        slab = next;
+    }
+    store->studentAllocator = (StudentAllocator) {NULL, 0, SLAB_STUDENTS, NULL, 0, 0, 0};
+}
+
+static Student *createStudent(AttendanceStore *store, int id, const char *name)
+{
+    Student *newStudent = allocateStudent(store);
+    newStudent->id = id;
+    strncpy(newStudent->name, name, MAX_NAME_LEN - 1);
+    newStudent->name[MAX_NAME_LEN - 1] = '\0';
+    memset(newStudent->subjects, 0, sizeof(newStudent->subjects));
+    newStudent->totals = (AttendanceTotals) {0, 0};
+    newStudent->next = NULL;
+    newStudent->suffixNext = NULL;
+    return newStudent;
+}
+
+static int compareNameKeys(const char *a, const char *b)
+{
+    while (*a && tolower((unsigned char) *a) == tolower((unsigned char) *b))
+    {
+        a++;
+        b++;
+    }
+    return tolower((unsigned char) *a) - tolower((unsigned char) *b);
+}
+
+// Orders entries by key, then ID and offset so every entry has a unique position.
+static int compareNameEntries(const void *a, const void *b)
+{
+    const NameEntry *x = (const NameEntry *) a;
+    const NameEntry *y = (const NameEntry *) b;
+    int order = compareNameKeys(x->student->name + x->offset, y->student->name + y->offset);
+    if (order != 0)
+    {
+        return order;
+    }
+    if (x->student->id != y->student->id)
+    {
+        return x->student->id < y->student->id ? -1 : 1;
+    }
+    return x->offset - y->offset;
+}
+
+int isNameWordStart(const char *name, int offset)
+{
+    return isalnum((unsigned char) name[offset]) &&
+           (offset == 0 || !isalnum((unsigned char) name[offset - 1]));
+}
+
+static void addToNameIndex(AttendanceStore *store, Student *student)
+{
+    NameIndex *index = &store->nameIndex;
+    for (int offset = 0; student->name[offset]; offset++)
+    {
+        if (!isNameWordStart(student->name, offset))
+        {
+            continue;
+        }
+        if (index->count == index->capacity)
+        {
+            index->capacity = index->capacity ? index->capacity * 2 : NAME_INDEX_INITIAL;
+            index->entries =
+                (NameEntry *) realloc(index->entries, index->capacity * sizeof(NameEntry));
+            if (!index->entries)
+            {
+                printf("Error: Memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        index->entries[index->count].student = student;
+        index->entries[index->count].offset = offset;
+        index->count++;
+    }
+}
+
+// First live entry at or after `position` in the sorted range, or sortedCount. A deleted entry's
+// offset is the distance to a later entry, so a run of deletions is crossed in a few jumps; the
+// jumps are shortened on the way, as in union-find, so later searches cross the run in one.
+static long nextLiveNameEntry(NameIndex *index, long position)
+{
+    long live = position;
+    while (live < index->sortedCount && index->entries[live].student == NULL)
+    {
+        live += index->entries[live].offset;
+    }
+    while (position < live)
+    {
+        long next = position + index->entries[position].offset;
+        index->entries[position].offset = (int) (live - position);
+        position = next;
+    }
+    return live;
+}
+
+// First position in the sorted range whose live entry is not below `target`; deleted entries are
+// stepped over, the live ones are still in order.
+static long nameLowerBound(AttendanceStore *store, const NameEntry *target, const char *prefix)
+{
+    long low = 0, high = store->nameIndex.sortedCount;
+    while (low < high)
+    {
+        long mid = low + (high - low) / 2;
+        long live = nextLiveNameEntry(&store->nameIndex, mid);
+        if (live >= high)
+        {
+            high = mid;
+            continue;
+        }
+        const NameEntry *entry = &store->nameIndex.entries[live];
+        int order = target ? compareNameEntries(entry, target)
+                           : compareNameKeys(entry->student->name + entry->offset, prefix);
+        if (order < 0)
+        {
+            low = live + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// Sorts the entries appended since the last query and merges them in, dropping deleted entries
+// once they make up an eighth of the index.
+void prepareNameIndex(AttendanceStore *store)
+{
+    NameIndex *index = &store->nameIndex;
+    if (index->sortedCount == index->count && index->removed * 8 <= index->count)
+    {
+        return;
+    }
+
+    long tail = index->sortedCount;
+    for (long i = index->sortedCount; i < index->count; i++)
+    {
+        if (index->entries[i].student)
+        {
+            index->entries[tail++] = index->entries[i];
+        }
+    }
+    qsort(index->entries + index->sortedCount, tail - index->sortedCount, sizeof(NameEntry),
+          compareNameEntries);
+
+    NameEntry *merged = (NameEntry *) malloc((index->capacity ? index->capacity : 1) *
+                                             sizeof(NameEntry));
+    if (!merged)
+    {
+        printf("Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    long left = 0, right = index->sortedCount, count = 0;
+    while (left < index->sortedCount || right < tail)
+    {
+        if (left < index->sortedCount && index->entries[left].student == NULL)
+        {
+            left++;
+        }
+        else if (right == tail || (left < index->sortedCount &&
+                                   compareNameEntries(&index->entries[left],
+                                                      &index->entries[right]) < 0))
+        {
+            merged[count++] = index->entries[left++];
+        }
+        else
+        {
+            merged[count++] = index->entries[right++];
+        }
+    }
+    free(index->entries);
+    index->entries = merged;
+    index->count = count;
+    index->sortedCount = count;
+    index->removed = 0;
+}
+
+// Turns the student's entries into tombstones. An entry still in the unsorted tail is found by
+// scanning the tail newest first; a tail too long to scan is merged first, so a removal never
+// scans more than INDEX_TAIL_SCAN entries however many students were added since the last query.
+// Tombstones are compacted away here too once they make up an eighth of the index, so deleting
+// without ever querying keeps the index small.
+static void removeFromNameIndex(AttendanceStore *store, Student *student)
+{
+    NameIndex *index = &store->nameIndex;
+    if (index->count - index->sortedCount > INDEX_TAIL_SCAN || index->removed * 8 > index->count)
+    {
+        prepareNameIndex(store);
+    }
+    for (int offset = 0; student->name[offset]; offset++)
+    {
+        if (!isNameWordStart(student->name, offset))
+        {
+            continue;
+        }
+        NameEntry target = {student, offset};
+        long position = nextLiveNameEntry(index, nameLowerBound(store, &target, NULL));
+        if (position == index->sortedCount || index->entries[position].student != student ||
+            index->entries[position].offset != offset)
+        {
+            for (position = index->count - 1; position >= index->sortedCount; position--)
+            {
+                if (index->entries[position].student == student &&
+                    index->entries[position].offset == offset)
+                {
+                    break;
+                }
+            }
+        }
+        if (position >= 0 && index->entries[position].student == student &&
+            index->entries[position].offset == offset)
+        {
+            index->entries[position].student = NULL;
+            index->entries[position].offset = 1;
+            index->removed++;
+        }
+    }
+}
+
+static void freeNameIndex(AttendanceStore *store)
+{
+    free(store->nameIndex.entries);
+    store->nameIndex = (NameIndex) {NULL, 0, 0, 0, 0};
+}
+
+static void addToIdIndex(AttendanceStore *store, Student *student)
+{
+    IdIndex *index = &store->idIndex;
+    if (index->count == index->capacity)
+    {
+        index->capacity = index->capacity ? index->capacity * 2 : ID_INDEX_INITIAL;
+        index->entries = (IdEntry *) realloc(index->entries, index->capacity * sizeof(IdEntry));
+        if (!index->entries)
+        {
+            printf("Error: Memory allocation failed.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    index->entries[index->count].id = student->id;
+    index->entries[index->count].student = student;
+    index->count++;
+}
+
+// First position in the sorted range with an ID not below `id`.
+static long idLowerBound(AttendanceStore *store, int id)
+{
+    long low = 0, high = store->idIndex.sortedCount;
+    while (low < high)
+    {
+        long mid = low + (high - low) / 2;
+        if (store->idIndex.entries[mid].id < id)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static int compareIdEntries(const void *a, const void *b)
+{
+    const IdEntry *x = (const IdEntry *) a;
+    const IdEntry *y = (const IdEntry *) b;
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+// Sorts the entries appended since the last ordered scan and merges them in, dropping deleted
+// entries once they make up an eighth of the index. A tail that already continues the order,
+// as when a sorted roster is loaded, is adopted without sorting.
+void prepareIdIndex(AttendanceStore *store)
+{
+    IdIndex *index = &store->idIndex;
+    if (index->sortedCount == index->count && index->removed * 8 <= index->count)
+    {
+        return;
+    }
+
+    long tail = index->sortedCount;
+    int inOrder = 1;
+    for (long i = index->sortedCount; i < index->count; i++)
+    {
+        if (index->entries[i].student)
+        {
+            IdEntry *previous = tail > 0 ? &index->entries[tail - 1] : NULL;
+            inOrder = inOrder && (!previous || previous->id < index->entries[i].id);
+            index->entries[tail++] = index->entries[i];
+        }
+    }
+    // Tombstones in the tail were dropped by the copy above, so they no longer count as removed
+    index->removed -= index->count - tail;
+    index->count = tail;
+    if (inOrder && index->removed * 8 <= index->count)
+    {
+        index->sortedCount = tail;
+        return;
+    }
+    qsort(index->entries + index->sortedCount, tail - index->sortedCount, sizeof(IdEntry),
+          compareIdEntries);
+
+    IdEntry *merged = (IdEntry *) malloc((index->capacity ? index->capacity : 1) * sizeof(IdEntry));
+    if (!merged)
+    {
+        printf("Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    long left = 0, right = index->sortedCount, count = 0;
+    while (left < index->sortedCount || right < tail)
+    {
+        if (left < index->sortedCount && index->entries[left].student == NULL)
+        {
+            left++;
+        }
+        else if (right == tail || (left < index->sortedCount &&
+                                   index->entries[left].id < index->entries[right].id))
+        {
+            merged[count++] = index->entries[left++];
+        }
+        else
+        {
+            merged[count++] = index->entries[right++];
+        }
+    }
+    free(index->entries);
+    index->entries = merged;
+    index->count = count;
+    index->sortedCount = count;
+    index->removed = 0;
+}
+
+// Same scheme as removeFromNameIndex.
+static void removeFromIdIndex(AttendanceStore *store, Student *student)
+{
+    IdIndex *index = &store->idIndex;
+    if (index->count - index->sortedCount > INDEX_TAIL_SCAN || index->removed * 8 > index->count)
+    {
+        prepareIdIndex(store);
+    }
+    long position = idLowerBound(store, student->id);
+    while (position < index->sortedCount && index->entries[position].id == student->id &&
+           index->entries[position].student != student)
+    {
+        position++;
+    }
+    if (position == index->sortedCount || index->entries[position].student != student)
+    {
+        for (position = index->count - 1; position >= index->sortedCount; position--)
+        {
+            if (index->entries[position].student == student)
+            {
+                break;
+            }
+        }
+    }
+    if (position >= 0 && index->entries[position].student == student)
+    {
+        index->entries[position].student = NULL;
+        index->removed++;
+    }
+}
+
+static void freeIdIndex(AttendanceStore *store)
+{
+    free(store->idIndex.entries);
+    store->idIndex = (IdIndex) {NULL, 0, 0, 0, 0};
+}
+
+Student *insertStudent(AttendanceStore *store, int id, const char *name)
+{
+    if (!store->hashTable.buckets)
+    {
+        store->hashTable.size = INITIAL_TABLE_SIZE;
+        store->hashTable.buckets = allocateBuckets(store->hashTable.size);
+    }
+    rehashStep(store, REHASH_STEP);
+    if (!store->hashTable.oldBuckets &&
+        store->hashTable.count >= store->hashTable.size * MAX_LOAD_FACTOR)
+    {
+        growHashTable(store);
+    }
+
+    int index = hashFunction(id, store->hashTable.size);
+    Student *newStudent = createStudent(store, id, name);
+    newStudent->next = store->hashTable.buckets[index];
+    store->hashTable.buckets[index] = newStudent;
+    store->hashTable.count++;
+
+    int slot = suffixSlot(id);
+    newStudent->suffixNext = store->suffixIndex[slot];
+    store->suffixIndex[slot] = newStudent;
+    addToNameIndex(store, newStudent);
+    addToIdIndex(store, newStudent);
+    return newStudent;
+}
+
+static Student **findLinkInChain(Student **link, int id)
+{
+    while (*link != NULL)
+    {
+        if ((*link)->id == id)
+        {
+            return link;
+        }
+        link = &(*link)->next;
+    }
+    return NULL;
+}
+
+// Returns the pointer that links `id` into its chain, or NULL. While a resize is in progress the
+// student may still sit in an unmigrated bucket of the old table; new inserts go to the new table.
+static Student **findStudentLink(AttendanceStore *store, int id)
+{
+    if (!store->hashTable.buckets)
+    {
+        return NULL;
+    }
+    if (store->hashTable.oldBuckets)
+    {
+        int oldIndex = hashFunction(id, store->hashTable.oldSize);
+        if (oldIndex >= store->hashTable.rehashIndex)
+        {
+            Student **link = findLinkInChain(&store->hashTable.oldBuckets[oldIndex], id);
+            if (link)
+            {
+                return link;
+            }
+        }
+    }
+    return findLinkInChain(&store->hashTable.buckets[hashFunction(id, store->hashTable.size)], id);
+}
+
+Student *findStudent(AttendanceStore *store, int id)
+{
+    Student **link = findStudentLink(store, id);
+    return link ? *link : NULL;
+}
+
+Student *nextStudent(AttendanceStore *store, StudentCursor *cursor)
+{
+    if (cursor->node)
+    {
+        cursor->node = cursor->node->next;
+    }
+    while (!cursor->node)
+    {
+        if (!cursor->inNewTable)
+        {
+            if (store->hashTable.oldBuckets && cursor->bucket < store->hashTable.oldSize)
+            {
+                cursor->node = store->hashTable.oldBuckets[cursor->bucket++];
+                continue;
+            }
+            cursor->inNewTable = 1;
+            cursor->bucket = 0;
+        }
+        if (cursor->bucket >= store->hashTable.size)
+        {
+            return NULL;
+        }
+        cursor->node = store->hashTable.buckets[cursor->bucket++];
+    }
+    return cursor->node;
+}
+
+Student *firstStudent(AttendanceStore *store, StudentCursor *cursor)
+{
+    cursor->inNewTable = 0;
+    cursor->bucket = 0;
+    cursor->node = NULL;
+    return nextStudent(store, cursor);
+}
+
+// IDs of four digits or fewer are looked up by their last four digits, anything longer must match
+// a full ID. A suffix shared by several students is ambiguous and resolves to NULL; *matches
+// reports how many students carry the ID or suffix so callers can ask for the full ID instead.
+Student *lookupStudent(AttendanceStore *store, int id, int *matches)
+{
+    *matches = 0;
+    if (id < 0 || id >= ID_SUFFIX_SLOTS)
+    {
+        Student *student = findStudent(store, id);
+        *matches = student ? 1 : 0;
+        return student;
+    }
+
+    Student *found = NULL;
+    for (Student *current = store->suffixIndex[id]; current != NULL; current = current->suffixNext)
+    {
+        found = current;
+        (*matches)++;
+    }
+    return *matches == 1 ? found : NULL;
+}
+
+Student *searchStudentById(AttendanceStore *store, int id)
+{
+    int matches;
+    return lookupStudent(store, id, &matches);
+}
+
+static int compareStudentNames(const void *a, const void *b)
+{
+    const Student *x = *(Student *const *) a;
+    const Student *y = *(Student *const *) b;
+    int order = compareNameKeys(x->name, y->name);
+    return order ? order : (x->id > y->id) - (x->id < y->id);
+}
+
+// Finds the students with a name word, or run of words, starting with `prefix` in any case.
+// Returns how many distinct students matched, in name order, in a malloc'ed *results.
+long findStudentsByName(AttendanceStore *store, const char *prefix, Student ***results)
+{
+    prepareNameIndex(store);
+    size_t length = strlen(prefix);
+    long first = nameLowerBound(store, NULL, prefix);
+    long count = 0, capacity = 16;
+    Student **matches = (Student **) malloc(capacity * sizeof(Student *));
+    if (!matches)
+    {
+        printf("Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (long i = first; i < store->nameIndex.sortedCount; i++)
+    {
+        const NameEntry *entry = &store->nameIndex.entries[i];
+        if (entry->student == NULL)
+        {
+            continue;
+        }
+        const char *key = entry->student->name + entry->offset;
+        size_t matched = 0;
+        while (matched < length &&
+               tolower((unsigned char) key[matched]) == tolower((unsigned char) prefix[matched]))
+        {
+            matched++;
+        }
+        if (matched < length)
+        {
+            break;
+        }
+        if (count == capacity)
+        {
+            capacity *= 2;
+            matches = (Student **) realloc(matches, capacity * sizeof(Student *));
+            if (!matches)
+            {
+                printf("Error: Memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        matches[count++] = entry->student;
+    }
+
+    // A name can match through several words; sorting puts those repeats next to each other.
+    qsort(matches, count, sizeof(Student *), compareStudentNames);
+    long unique = 0;
+    for (long i = 0; i < count; i++)
+    {
+        if (unique == 0 || matches[unique - 1] != matches[i])
+        {
+            matches[unique++] = matches[i];
+        }
+    }
+    *results = matches;
+    return unique;
+}
+
+int percentageOf(AttendanceTotals totals)
+{
+    if (totals.recorded == 0) return 0;
+    float percentage = (float)totals.present / totals.recorded * 100;
+    return (int)(percentage + 0.5f);
+}
+
+// Parses an ID range given as "LOW HIGH", or as one ID whose trailing x's are wildcards
+// (5900115xx covers 590011500 to 590011599). Returns 0 on success.
+int parseIdRange(const char *first, const char *second, int *low, int *high)
+{
+    char *end;
+    if (second)
+    {
+        long from = strtol(first, &end, 10);
+        if (*first == '\0' || *end != '\0')
+        {
+            return -1;
+        }
+        long to = strtol(second, &end, 10);
+        if (*second == '\0' || *end != '\0' || from > to || from < INT_MIN || to > INT_MAX)
+        {
+            return -1;
+        }
+        *low = (int) from;
+        *high = (int) to;
+        return 0;
+    }
+
+    long from = 0, to = 0;
+    int digits = 0;
+    for (const char *p = first; *p; p++)
+    {
+        if (*p >= '0' && *p <= '9' && to == from)
+        {
+            from = from * 10 + (*p - '0');
+            to = from;
+        }
+        else if (*p == 'x' || *p == 'X')
+        {
+            from = from * 10;
+            to = to * 10 + 9;
+        }
+        else
+        {
+            return -1;
+        }
+        if (++digits > 10 || to > 2147483647L)
+        {
+            return -1;
+        }
+    }
+    if (digits == 0)
+    {
+        return -1;
+    }
+    *low = (int) from;
+    *high = (int) to;
+    return 0;
+}
+
+// Collects the students with low <= ID <= high, in ID order, into a malloc'ed *results.
+long findStudentsInRange(AttendanceStore *store, int low, int high, Student ***results)
+{
+    prepareIdIndex(store);
+    long count = 0, capacity = 16;
+    Student **matches = (Student **) malloc(capacity * sizeof(Student *));
+    if (!matches)
+    {
+        printf("Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (long entry = idLowerBound(store, low);
+         entry < store->idIndex.sortedCount && store->idIndex.entries[entry].id <= high; entry++)
+    {
+        if (!store->idIndex.entries[entry].student)
+        {
+            continue;
+        }
+        if (count == capacity)
+        {
+            capacity *= 2;
+            matches = (Student **) realloc(matches, capacity * sizeof(Student *));
+            if (!matches)
+            {
+                printf("Error: Memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        matches[count++] = store->idIndex.entries[entry].student;
+    }
+    *results = matches;
+    return count;
+}
+
+// Recounts a student's attendance from the raw masks; the counters below avoid this on queries.
+AttendanceTotals countAttendance(AttendanceStore *store, const Student *student)
+{
+    AttendanceTotals totals = {0, 0};
+    for (int i = 0; i < store->subjectCount; i++)
+    {
+        totals.recorded += popcount32(student->subjects[i].recorded);
+        totals.present += popcount32(student->subjects[i].present);
+    }
+    return totals;
+}
+
+AttendanceTotals studentAttendance(const Student *student)
+{
+    return student->totals;
+}
+
+AttendanceTotals subjectAttendance(AttendanceStore *store, int subjectIndex)
+{
+    AttendanceTotals totals = {0, 0};
+    for (int i = 0; i < TABLE_STRIPES; i++)
+    {
+        totals.recorded += store->tableStripes[i].subjectTotals[subjectIndex].recorded;
+        totals.present += store->tableStripes[i].subjectTotals[subjectIndex].present;
+    }
+    return totals;
+}
+
+AttendanceTotals classAttendance(AttendanceStore *store)
+{
+    AttendanceTotals totals = {0, 0};
+    for (int i = 0; i < store->subjectCount; i++)
+    {
+        AttendanceTotals subject = subjectAttendance(store, i);
+        totals.recorded += subject.recorded;
+        totals.present += subject.present;
+    }
+    return totals;
+}
+
+// Compares present/recorded against `threshold` percent without dividing.
+int isBelowThreshold(AttendanceTotals totals, int threshold)
+{
+    return totals.recorded > 0 && totals.present * 100 < (long) threshold * totals.recorded;
+}
+
+int total_percentage(Student *student)
+{
+    return percentageOf(studentAttendance(student));
+}
+
+// Unlinks and frees the student with exactly this ID; returns 0 on success and -1 if not found.
+int removeStudent(AttendanceStore *store, int id)
+{
+    if (!store->hashTable.buckets)
+    {
+        return -1;
+    }
+    rehashStep(store, REHASH_STEP);
+
+    Student **link = findStudentLink(store, id);
+    if (!link)
+    {
+        return -1;
+    }
+    Student *current = *link;
+    *link = current->next;
+    store->hashTable.count--;
+
+    Student **suffixLink = &store->suffixIndex[suffixSlot(id)];
+    while (*suffixLink != current)
+    {
+        suffixLink = &(*suffixLink)->suffixNext;
+    }
+    *suffixLink = current->suffixNext;
+    removeFromNameIndex(store, current);
+    removeFromIdIndex(store, current);
+    accountStudent(store, current, -1);
+    releaseStudent(store, current);
+    return 0;
+}
+
+void freeHashTable(AttendanceStore *store)
+{
+    free(store->hashTable.oldBuckets);
+    free(store->hashTable.buckets);
+    releaseAllStudents(store);
+    store->hashTable = (HashTable) {NULL, 0, NULL, 0, 0, 0};
+    memset(store->suffixIndex, 0, sizeof(store->suffixIndex));
+    resetStripeCounters(store);
+    freeNameIndex(store);
+    freeIdIndex(store);
+}
+
+static uint32_t journalChecksum(const unsigned char *data, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Writes the buffered records and, when `sync` is set, syncs everything written so far to disk as
+// one group. Appends switch to the other buffer under journal.lock and the write and fsync run
+// under journal.writeLock alone, so markers keep appending while a group is being synced.
+static int journalWrite(AttendanceStore *store, int sync)
+{
+    pthread_mutex_lock(&store->journal.writeLock);
+    pthread_mutex_lock(&store->journal.lock);
+    const unsigned char *buffer = store->journal.buffers[store->journal.active];
+    size_t used = store->journal.used;
+    store->journal.active ^= 1;
+    store->journal.used = 0;
+    store->journal.pendingRecords = 0;
+    pthread_mutex_unlock(&store->journal.lock);
+
+    FILE *file = store->journal.file;
+    if (!file || (used == 0 && !(sync && store->journal.unsynced)))
+    {
+        pthread_mutex_unlock(&store->journal.writeLock);
+        return 0;
+    }
+    int status = 0;
+    if (used > 0 && (fwrite(buffer, 1, used, file) != used || fflush(file) != 0))
+    {
+        status = -1;
+    }
+#if HAVE_POSIX
+    if (status == 0 && sync && fsync(fileno(file)) != 0)
+    {
+        status = -1;
+    }
+#endif
+    if (status != 0)
+    {
+        printf("Error: Could not write journal %s\n", store->journal.path);
+    }
+    store->journal.unsynced = !sync;
+    if (sync)
+    {
+        __atomic_add_fetch(&store->journal.syncs, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&store->journal.writeLock);
+    return status;
+}
+
+int journalCommit(AttendanceStore *store)
+{
+    return journalWrite(store, 1);
+}
+
+// Commits a group as soon as JOURNAL_GROUP_COMMIT records are pending, and whatever is pending
+// every JOURNAL_COMMIT_INTERVAL_MS, so a mark typed just before a crash is on disk even if its
+// group never filled up.
+static void *journalFlusher(void *arg)
+{
+    AttendanceStore *store = (AttendanceStore *) arg;
+    pthread_mutex_lock(&store->journal.lock);
+    while (!store->journal.stopFlusher)
+    {
+        if (store->journal.pendingRecords < JOURNAL_GROUP_COMMIT || store->journal.bulk)
+        {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += JOURNAL_COMMIT_INTERVAL_MS * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&store->journal.wake, &store->journal.lock, &deadline);
+        }
+        if (store->journal.pendingRecords > 0 && !store->journal.bulk)
+        {
+            pthread_mutex_unlock(&store->journal.lock);
+            journalWrite(store, 1);
+            pthread_mutex_lock(&store->journal.lock);
+        }
+    }
+    pthread_mutex_unlock(&store->journal.lock);
+    return NULL;
+}
+
+// Buffers one record. A full group is handed to the flusher thread, so the caller (often holding
+// a stripe lock) only writes to the file itself when the buffer is full or no flusher runs.
+static void journalAppend(AttendanceStore *store, JournalOp op, const unsigned char *payload,
+                          int length)
+{
+    if (!store->journal.file)
+    {
+        return; // only opened and closed while no other thread runs, so no lock is needed
+    }
+    pthread_mutex_lock(&store->journal.lock);
+    while (store->journal.file && store->journal.used + length + 6 > JOURNAL_BUFFER_SIZE)
+    {
+        int sync = !store->journal.bulk;
+        pthread_mutex_unlock(&store->journal.lock);
+        journalWrite(store, sync);
+        pthread_mutex_lock(&store->journal.lock);
+    }
+    if (!store->journal.file)
+    {
+        pthread_mutex_unlock(&store->journal.lock);
+        return;
+    }
+    unsigned char *record = store->journal.buffers[store->journal.active] + store->journal.used;
+    record[0] = (unsigned char) op;
+    record[1] = (unsigned char) length;
+    memcpy(record + 2, payload, (size_t) length);
+    uint32_t checksum = journalChecksum(record, (size_t) length + 2);
+    memcpy(record + 2 + length, &checksum, sizeof(checksum));
+    store->journal.used += (size_t) length + 6;
+    store->journal.records++;
+    int commit = ++store->journal.pendingRecords >= JOURNAL_GROUP_COMMIT && !store->journal.bulk;
+    if (commit && store->journal.flusherRunning)
+    {
+        pthread_cond_signal(&store->journal.wake);
+        commit = 0;
+    }
+    pthread_mutex_unlock(&store->journal.lock);
+    if (commit)
+    {
+        journalWrite(store, 1);
+    }
+}
+
+// Loads and imports journal thousands of records at once: while one runs, full buffers are written
+// without an fsync and the whole operation is synced once when it ends.
+static void journalBeginBulk(AttendanceStore *store)
+{
+    pthread_mutex_lock(&store->journal.lock);
+    store->journal.bulk++;
+    pthread_mutex_unlock(&store->journal.lock);
+}
+
+static void journalEndBulk(AttendanceStore *store)
+{
+    pthread_mutex_lock(&store->journal.lock);
+    int done = --store->journal.bulk == 0;
+    pthread_mutex_unlock(&store->journal.lock);
+    if (done)
+    {
+        journalWrite(store, 1);
+    }
+}
+
+void journalInsert(AttendanceStore *store, int id, const char *name)
+{
+    unsigned char payload[4 + MAX_NAME_LEN];
+    int nameLen = (int) strlen(name);
+    memcpy(payload, &id, 4);
+    memcpy(payload + 4, name, (size_t) nameLen);
+    journalAppend(store, JOURNAL_INSERT, payload, 4 + nameLen);
+}
+
+static void journalDelete(AttendanceStore *store, int id)
+{
+    journalAppend(store, JOURNAL_DELETE, (const unsigned char *) &id, 4);
+}
+
+static void journalSubject(AttendanceStore *store, int subjectIndex, const char *name)
+{
+    unsigned char payload[1 + MAX_NAME_LEN];
+    int nameLen = (int) strlen(name);
+    payload[0] = (unsigned char) subjectIndex;
+    memcpy(payload + 1, name, (size_t) nameLen);
+    journalAppend(store, JOURNAL_SUBJECT, payload, 1 + nameLen);
+}
+
+static void journalRollCall(AttendanceStore *store, int subjectIndex, int day)
+{
+    unsigned char payload[2] = {(unsigned char) subjectIndex, (unsigned char) day};
+    journalAppend(store, JOURNAL_ROLL_CALL, payload, 2);
+}
+
+static void journalMark(AttendanceStore *store, int id, int subjectIndex, int day, int status)
+{
+    unsigned char payload[7];
+    memcpy(payload, &id, 4);
+    payload[4] = (unsigned char) subjectIndex;
+    payload[5] = (unsigned char) day;
+    payload[6] = (unsigned char) (signed char) status;
+    journalAppend(store, JOURNAL_MARK, payload, 7);
+}
+
+void deleteStudentById(AttendanceStore *store, int id)
+{
+    if (removeStudent(store, id) == 0)
+    {
+        journalDelete(store, id);
+        printf("Student with ID %d deleted successfully.\n", id);
+    }
+    else
+    {
+        printf("Student with ID %d not found.\n", id);
+    }
+}
+
+// Starts a roll call: every student is recorded absent for the day until marked present.
+void beginRollCall(AttendanceStore *store, int subjectIndex, int day)
+{
+    StudentCursor cursor;
+    for (Student *current = firstStudent(store, &cursor); current != NULL;
+         current = nextStudent(store, &cursor))
+    {
+        setAttendance(store, current, subjectIndex, day, 0);
+    }
+    journalRollCall(store, subjectIndex, day);
+}
+
+void markStudent(AttendanceStore *store, Student *student, int subjectIndex, int day, int status)
+{
+    setAttendance(store, student, subjectIndex, day, status);
+    journalMark(store, student->id, subjectIndex, day, status);
+}
+
+// Looks a subject up without registering it; returns -1 if it is unknown.
+int findSubjectIndex(AttendanceStore *store, const char *subject)
+{
+    for (int i = 0; i < store->subjectCount; i++)
+    {
+        if (strcmp(store->subjectList[i], subject) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int getSubjectIndex(AttendanceStore *store, const char *subject)
+{
+    for (int i = 0; i < store->subjectCount; i++)
+    {
+        if (strcmp(store->subjectList[i], subject) == 0)
+        {
+            return i;
+        }
+    }
+    if (store->subjectCount < MAX_SUBJECTS)
+    {
+        strncpy(store->subjectList[store->subjectCount], subject, MAX_NAME_LEN - 1);
+        store->subjectList[store->subjectCount][MAX_NAME_LEN - 1] = '\0';
+        journalSubject(store, store->subjectCount, store->subjectList[store->subjectCount]);
+        return store->subjectCount++;
+    }
+    printf("Error: Maximum number of subjects reached.\n");
+    return -1;
+}
+
+// Thread-safe entry points for several threads sharing the table. Looking a student up and
+// marking them holds only their stripe's lock; anything that changes the table's shape or the
+// subject list holds every stripe. A stripe lock is never taken while holding another one.
+
+// Returns the student with their stripe locked, or NULL with nothing locked. A suffix lookup can
+// resolve to a student on another stripe; the lock is then moved to that stripe and the student
+// looked up again by full ID, in case they were deleted in between.
+static Student *lockStudent(AttendanceStore *store, int id)
+{
+    TableStripe *stripe = stripeFor(store, id);
+    pthread_mutex_lock(&stripe->lock);
+    int matches;
+    Student *student = lookupStudent(store, id, &matches);
+    if (student && stripeFor(store, student->id) != stripe)
+    {
+        int fullId = student->id;
+        pthread_mutex_unlock(&stripe->lock);
+        stripe = stripeFor(store, fullId);
+        pthread_mutex_lock(&stripe->lock);
+        student = findStudent(store, fullId);
+    }
+    if (!student)
+    {
+        pthread_mutex_unlock(&stripe->lock);
+    }
+    return student;
+}
+
+static void unlockStudent(AttendanceStore *store, const Student *student)
+{
+    pthread_mutex_unlock(&stripeFor(store, student->id)->lock);
+}
+
+// Returns -1 for an unknown student and -2 for a subject or day that does not exist.
+int concurrentMark(AttendanceStore *store, int id, int subjectIndex, int day, int status)
+{
+    Student *student = lockStudent(store, id);
+    if (!student)
+    {
+        return -1;
+    }
+    if (subjectIndex < 0 || subjectIndex >= store->subjectCount || day < 0 || day >= MAX_DAYS)
+    {
+        unlockStudent(store, student);
+        return -2;
+    }
+    markStudent(store, student, subjectIndex, day, status);
+    unlockStudent(store, student);
+    return 0;
+}
+
+// Copies a consistent view of one student's record into *copy.
+int concurrentView(AttendanceStore *store, int id, Student *copy)
+{
+    Student *student = lockStudent(store, id);
+    if (!student)
+    {
+        return -1;
+    }
+    *copy = *student;
+    unlockStudent(store, student);
+    return 0;
+}
+
+int concurrentInsert(AttendanceStore *store, int id, const char *name)
+{
+    lockAllStripes(store);
+    int exists = findStudent(store, id) != NULL;
+    if (!exists)
+    {
+        insertStudent(store, id, name);
+        journalInsert(store, id, name);
+    }
+    unlockAllStripes(store);
+    return exists ? -1 : 0;
+}
+
+int concurrentDelete(AttendanceStore *store, int id)
+{
+    lockAllStripes(store);
+    int result = removeStudent(store, id);
+    if (result == 0)
+    {
+        journalDelete(store, id);
+    }
+    unlockAllStripes(store);
+    return result;
+}
+
+// Finds a subject, registering it under every stripe lock only when it is new.
+int concurrentSubjectIndex(AttendanceStore *store, const char *subject)
+{
+    TableStripe *stripe = &store->tableStripes[0];
+    pthread_mutex_lock(&stripe->lock);
+    int subjectIndex = findSubjectIndex(store, subject);
+    pthread_mutex_unlock(&stripe->lock);
+    if (subjectIndex == -1)
+    {
+        lockAllStripes(store);
+        subjectIndex = getSubjectIndex(store, subject);
+        unlockAllStripes(store);
+    }
+    return subjectIndex;
+}
+
+// Maps the whole file read-only; falls back to reading it into memory where mmap is unavailable.
+int mapFile(const char *filename, MappedFile *file)
+{
+    file->data = NULL;
+    file->size = 0;
+    file->mapped = 0;
+#if HAVE_POSIX
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    if (st.st_size > 0)
+    {
+        void *data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            return -1;
+        }
+        posix_madvise(data, (size_t) st.st_size, POSIX_MADV_SEQUENTIAL);
+        file->data = (const char *) data;
+        file->size = (size_t) st.st_size;
+        file->mapped = 1;
+    }
+    close(fd);
+    return 0;
+#else
+    FILE *fp = fopen(filename, "rb");
+    if (!fp)
+    {
+        return -1;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (size > 0)
+    {
+        char *data = (char *) malloc((size_t) size);
+        if (!data)
+        {
+            printf("Error: Memory allocation failed.\n");
+            exit(EXIT_FAILURE);
+        }
+        file->size = fread(data, 1, (size_t) size, fp);
+        file->data = data;
+    }
+    fclose(fp);
+    return 0;
+#endif
+}
+
+void unmapFile(MappedFile *file)
+{
+#if HAVE_POSIX
+    if (file->mapped)
+    {
+        munmap((void *) file->data, file->size);
+    }
+#else
+    free((void *) file->data);
+#endif
+    file->data = NULL;
+    file->size = 0;
+}
+
+// Parses one "id,name" record from [line, end), where `end` is the line's newline or end of file.
+// The name is returned as a view into the line with a trailing '\r' dropped.
+static int parseRosterLine(const char *line, const char *end, int *id, const char **name,
+                           int *nameLen)
+{
+    const char *p = line;
+    while (p < end && (*p == ' ' || *p == '\t'))
+    {
+        p++;
+    }
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        p++;
+    }
+    const char *digits = p;
+    long value = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+        value = value * 10 + (*p - '0');
+        if (value > 2147483647L)
+        {
+            return 0;
+        }
+        p++;
+    }
+    if (p == digits || p == end || *p != ',')
+    {
+        return 0;
+    }
+    p++;
+
+    const char *nameEnd = end;
+    if (nameEnd > p && nameEnd[-1] == '\r')
+    {
+        nameEnd--;
+    }
+    if (nameEnd == p)
+    {
+        return 0;
+    }
+    *id = (int) (negative ? -value : value);
+    *name = p;
+    *nameLen = (int) (nameEnd - p);
+    return 1;
+}
+
+int resolveThreadCount(AttendanceStore *store)
+{
+    long threads = store->workerThreads;
+#if HAVE_POSIX
+    if (threads <= 0)
+    {
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+#endif
+    if (threads < 1)
+    {
+        threads = 1;
+    }
+    return threads > MAX_WORKER_THREADS ? MAX_WORKER_THREADS : (int) threads;
+}
+
+static void *parseRosterChunk(void *arg)
+{
+    RosterChunk *chunk = (RosterChunk *) arg;
+    const char *p = chunk->begin;
+    while (p < chunk->end)
+    {
+        const char *lineEnd = memchr(p, '\n', (size_t) (chunk->end - p));
+        if (!lineEnd)
+        {
+            lineEnd = chunk->end;
+        }
+
+        if (chunk->count == chunk->capacity)
+        {
+            chunk->capacity = chunk->capacity ? chunk->capacity * 2 : 4096;
+            chunk->records =
+                (RosterRecord *) realloc(chunk->records, chunk->capacity * sizeof(RosterRecord));
+            if (!chunk->records)
+            {
+                printf("Error: Memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        RosterRecord *record = &chunk->records[chunk->count++];
+        record->valid = parseRosterLine(p, lineEnd, &record->id, &record->text, &record->length);
+        if (record->valid)
+        {
+            chunk->validCount++;
+        }
+        else
+        {
+            record->text = p;
+            record->length = (int) (lineEnd - p);
+        }
+        p = lineEnd + 1;
+    }
+    return NULL;
+}
+
+// Splits the mapped roster at newline boundaries, parses the chunks on worker threads into
+// per-chunk staging arrays, then inserts the chunks in file order so the resulting table is the
+// same whatever the thread count.
+void loadStudentsFromFile(AttendanceStore *store, const char *filename)
+{
+    MappedFile file;
+    double start = nowSeconds();
+    if (mapFile(filename, &file) != 0)
+    {
+        printf("Error: Could not open file %s\n", filename);
+        return;
+    }
+
+    int chunkCount = resolveThreadCount(store);
+    size_t maxChunks = file.size / LOADER_MIN_CHUNK_BYTES;
+    if ((size_t) chunkCount > maxChunks)
+    {
+        chunkCount = maxChunks > 0 ? (int) maxChunks : 1;
+    }
+
+    RosterChunk chunks[MAX_WORKER_THREADS];
+    const char *end = file.data + file.size;
+    const char *p = file.data;
+    for (int i = 0; i < chunkCount; i++)
+    {
+        const char *chunkEnd = file.data + file.size / chunkCount * (i + 1);
+        if (i == chunkCount - 1)
+        {
+            chunkEnd = end;
+        }
+        if (chunkEnd < p)
+        {
+            chunkEnd = p;
+        }
+        if (chunkEnd < end)
+        {
+            const char *newline = memchr(chunkEnd, '\n', (size_t) (end - chunkEnd));
+            chunkEnd = newline ? newline + 1 : end;
+        }
+        chunks[i] = (RosterChunk) {p, chunkEnd, NULL, 0, 0, 0};
+        p = chunkEnd;
+    }
+
+    pthread_t threads[MAX_WORKER_THREADS];
+    int started[MAX_WORKER_THREADS] = {0};
+    for (int i = 1; i < chunkCount; i++)
+    {
+        started[i] = pthread_create(&threads[i], NULL, parseRosterChunk, &chunks[i]) == 0;
+    }
+    long expected = 0;
+    for (int i = 0; i < chunkCount; i++)
+    {
+        if (started[i])
+        {
+            pthread_join(threads[i], NULL);
+        }
+        else
+        {
+            parseRosterChunk(&chunks[i]);
+        }
+        expected += chunks[i].validCount;
+    }
+
+    reserveHashTable(store, expected);
+    journalBeginBulk(store);
+    long loaded = 0, duplicates = 0;
+    for (int i = 0; i < chunkCount; i++)
+    {
+        for (long r = 0; r < chunks[i].count; r++)
+        {
+            RosterRecord *record = &chunks[i].records[r];
+            if (!record->valid)
+            {
+                printf("Warning: Skipping invalid line: %.*s\n", record->length, record->text);
+                continue;
+            }
+            char name[MAX_NAME_LEN];
+            int nameLen = record->length > MAX_NAME_LEN - 1 ? MAX_NAME_LEN - 1 : record->length;
+            memcpy(name, record->text, (size_t) nameLen);
+            name[nameLen] = '\0';
+            if (findStudent(store, record->id))
+            {
+                duplicates++;
+                continue;
+            }
+            insertStudent(store, record->id, name);
+            journalInsert(store, record->id, name);
+            loaded++;
+        }
+        free(chunks[i].records);
+    }
+    journalEndBulk(store);
+
+    double elapsed = nowSeconds() - start;
+    double megabytes = file.size / (1024.0 * 1024.0);
+    unmapFile(&file);
+    if (store->quiet)
+    {
+        return;
+    }
+    printf("Students loaded successfully from %s\n", filename);
+    if (duplicates > 0)
+    {
+        printf("Skipped %ld students whose ID is already loaded\n", duplicates);
+    }
+    printf("Loaded %ld students on %d thread%s (%.1f MB in %.1f ms, %.1f MB/s)\n", loaded,
+           chunkCount, chunkCount == 1 ? "" : "s", megabytes, elapsed * 1e3,
+           elapsed > 0 ? megabytes / elapsed : 0.0);
+}
+
+static int writeSnapshotFile(AttendanceStore *store, FILE *file)
+{
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.recordSize = sizeof(SnapshotRecord);
+    header.subjectCount = (uint32_t) store->subjectCount;
+    header.studentCount = (uint64_t) store->hashTable.count;
+    header.checkpoint = store->checkpointId;
+    memcpy(header.subjects, store->subjectList, sizeof(store->subjectList));
+    if (fwrite(&header, sizeof(header), 1, file) != 1)
+    {
+        return -1;
+    }
+
+    SnapshotRecord *batch = (SnapshotRecord *) calloc(SNAPSHOT_WRITE_BATCH, sizeof(SnapshotRecord));
+    if (!batch)
+    {
+        printf("Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    int pending = 0;
+    int status = 0;
+    StudentCursor cursor;
+    for (Student *current = firstStudent(store, &cursor); current != NULL;
+         current = nextStudent(store, &cursor))
+    {
+        SnapshotRecord *record = &batch[pending++];
+        record->id = current->id;
+        memcpy(record->name, current->name, MAX_NAME_LEN);
+        memcpy(record->subjects, current->subjects, sizeof(record->subjects));
+        if (pending == SNAPSHOT_WRITE_BATCH)
+        {
+            if (fwrite(batch, sizeof(SnapshotRecord), pending, file) != (size_t) pending)
+            {
+                status = -1;
+                break;
+            }
+            pending = 0;
+        }
+    }
+    if (status == 0 && fwrite(batch, sizeof(SnapshotRecord), pending, file) != (size_t) pending)
+    {
+        status = -1;
+    }
+    free(batch);
+    return status;
+}
+
+// Writes the roster, subject list and attendance masks to `filename`. The data goes to a temporary
+// file that is synced and renamed over the old snapshot, so a crash never leaves a torn snapshot.
+int saveSnapshot(AttendanceStore *store, const char *filename)
+{
+    char tempName[512];
+    snprintf(tempName, sizeof(tempName), "%s.tmp", filename);
+    FILE *file = fopen(tempName, "wb");
+    if (!file)
+    {
+        printf("Error: Could not open file %s for writing\n", tempName);
+        return -1;
+    }
+    setvbuf(file, NULL, _IOFBF, 1 << 20);
+
+    int status = writeSnapshotFile(store, file);
+    if (fflush(file) != 0)
+    {
+        status = -1;
+    }
+#if HAVE_POSIX
+    if (status == 0 && fsync(fileno(file)) != 0)
+    {
+        status = -1;
+    }
+#endif
+    fclose(file);
+    if (status != 0 || rename(tempName, filename) != 0)
+    {
+        printf("Error: Could not write snapshot %s\n", filename);
+        remove(tempName);
+        return -1;
+    }
+    return 0;
+}
+
+// Replaces the current state with the snapshot in `filename`.
+int loadSnapshot(AttendanceStore *store, const char *filename)
+{
+    MappedFile file;
+    if (mapFile(filename, &file) != 0)
+    {
+        printf("Error: Could not open file %s\n", filename);
+        return -1;
+    }
+
+    const SnapshotHeader *header = (const SnapshotHeader *) file.data;
+    if (file.size < sizeof(SnapshotHeader) ||
+        memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+    {
+        printf("Error: %s is not an attendance snapshot\n", filename);
+        unmapFile(&file);
+        return -1;
+    }
+    // The record count is checked by division so a huge count cannot wrap the size computation
+    size_t recordBytes = file.size - sizeof(SnapshotHeader);
+    int layoutValid = header->version == SNAPSHOT_VERSION &&
+                      header->byteOrder == SNAPSHOT_BYTE_ORDER &&
+                      header->recordSize == sizeof(SnapshotRecord) &&
+                      header->subjectCount <= MAX_SUBJECTS &&
+                      recordBytes % sizeof(SnapshotRecord) == 0 &&
+                      header->studentCount == recordBytes / sizeof(SnapshotRecord);
+    for (uint32_t i = 0; layoutValid && i < MAX_SUBJECTS; i++)
+    {
+        layoutValid = memchr(header->subjects[i], '\0', MAX_NAME_LEN) != NULL;
+    }
+    if (!layoutValid)
+    {
+        printf("Error: Snapshot %s has an unsupported version or layout\n", filename);
+        unmapFile(&file);
+        return -1;
+    }
+
+    freeHashTable(store);
+    memcpy(store->subjectList, header->subjects, sizeof(store->subjectList));
+    store->subjectCount = (int) header->subjectCount;
+    store->checkpointId = header->checkpoint;
+    reserveHashTable(store, (long) header->studentCount);
+
+    const SnapshotRecord *records = (const SnapshotRecord *) (file.data + sizeof(SnapshotHeader));
+    for (uint64_t i = 0; i < header->studentCount; i++)
+    {
+        const SnapshotRecord *record = &records[i];
+        Student *student = insertStudent(store, record->id, record->name);
+        memcpy(student->subjects, record->subjects, sizeof(student->subjects));
+        student->totals = countAttendance(store, student);
+        accountStudent(store, student, 1);
+    }
+    unmapFile(&file);
+    return 0;
+}
+
+// Starts a fresh journal containing only a header for the current checkpoint.
+static int resetJournal(AttendanceStore *store)
+{
+    pthread_mutex_lock(&store->journal.writeLock);
+    pthread_mutex_lock(&store->journal.lock);
+    if (store->journal.file)
+    {
+        fclose(store->journal.file);
+    }
+    store->journal.file = fopen(store->journal.path, "wb");
+    if (!store->journal.file)
+    {
+        printf("Error: Could not open journal %s\n", store->journal.path);
+        pthread_mutex_unlock(&store->journal.lock);
+        pthread_mutex_unlock(&store->journal.writeLock);
+        return -1;
+    }
+    JournalHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    header.version = JOURNAL_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.checkpoint = store->checkpointId;
+    store->journal.used = 0;
+    store->journal.pendingRecords = 0;
+    store->journal.unsynced = 0;
+    int status = 0;
+    if (fwrite(&header, sizeof(header), 1, store->journal.file) != 1 ||
+        fflush(store->journal.file) != 0)
+    {
+        printf("Error: Could not write journal %s\n", store->journal.path);
+        status = -1;
+    }
+#if HAVE_POSIX
+    if (status == 0)
+    {
+        fsync(fileno(store->journal.file));
+    }
+#endif
+    pthread_mutex_unlock(&store->journal.lock);
+    pthread_mutex_unlock(&store->journal.writeLock);
+    return status;
+}
+
+static void applyJournalRecord(AttendanceStore *store, JournalOp op, const unsigned char *payload,
+                               int length)
+{
+    int id;
+    char name[MAX_NAME_LEN];
+    switch (op)
+    {
+        case JOURNAL_INSERT:
+            memcpy(&id, payload, 4);
+            memcpy(name, payload + 4, (size_t) (length - 4));
+            name[length - 4] = '\0';
+            if (!findStudent(store, id))
+            {
+                insertStudent(store, id, name);
+            }
+            break;
+        case JOURNAL_DELETE:
+            memcpy(&id, payload, 4);
+            removeStudent(store, id);
+            break;
+        case JOURNAL_SUBJECT:
+            memcpy(name, payload + 1, (size_t) (length - 1));
+            name[length - 1] = '\0';
+            if (payload[0] == store->subjectCount)
+            {
+                getSubjectIndex(store, name);
+            }
+            break;
+        case JOURNAL_ROLL_CALL:
+            beginRollCall(store, payload[0], payload[1]);
+            break;
+        case JOURNAL_MARK:
+        {
+            memcpy(&id, payload, 4);
+            Student *student = findStudent(store, id);
+            if (student)
+            {
+                setAttendance(store, student, payload[4], payload[5], (signed char) payload[6]);
+            }
+            break;
+        }
+    }
+}
+
+static int validJournalRecord(const unsigned char *record, size_t available)
+{
+    if (available < 6 || record[0] < JOURNAL_INSERT || record[0] > JOURNAL_MARK)
+    {
+        return 0;
+    }
+    size_t length = record[1];
+    if (available < length + 6)
+    {
+        return 0;
+    }
+    uint32_t checksum;
+    memcpy(&checksum, record + 2 + length, sizeof(checksum));
+    if (checksum != journalChecksum(record, length + 2))
+    {
+        return 0;
+    }
+    const unsigned char *payload = record + 2;
+    switch (record[0])
+    {
+        case JOURNAL_INSERT:
+            return length > 4 && length < 4 + MAX_NAME_LEN;
+        case JOURNAL_DELETE:
+            return length == 4;
+        case JOURNAL_SUBJECT:
+            return length > 1 && length < 1 + MAX_NAME_LEN && payload[0] < MAX_SUBJECTS;
+        case JOURNAL_ROLL_CALL:
+            return length == 2 && payload[0] < MAX_SUBJECTS && payload[1] < MAX_DAYS;
+        case JOURNAL_MARK:
+            return length == 7 && payload[4] < MAX_SUBJECTS && payload[5] < MAX_DAYS &&
+                   (signed char) payload[6] >= -1 && (signed char) payload[6] <= 1;
+    }
+    return 0;
+}
+
+// Replays the journal on top of the loaded snapshot. Returns the number of records applied, -1
+// when there is no journal or it belongs to an older snapshot and can be discarded, or -2 when it
+// cannot be used without losing changes. Replay stops at the first torn or corrupt record and
+// *validEnd is set to the offset where appending resumes.
+static long replayJournal(AttendanceStore *store, const char *path, size_t *validEnd)
+{
+    MappedFile file;
+    *validEnd = 0;
+    if (mapFile(path, &file) != 0)
+    {
+        if (errno == ENOENT)
+        {
+            return -1;
+        }
+        printf("Error: Could not read journal %s\n", path);
+        return -2;
+    }
+    if (file.size < sizeof(JournalHeader))
+    {
+        unmapFile(&file); // cut short while being created, so it holds no records
+        return -1;
+    }
+    const JournalHeader *header = (const JournalHeader *) file.data;
+    if (memcmp(header->magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 ||
+        header->version != JOURNAL_VERSION || header->byteOrder != SNAPSHOT_BYTE_ORDER)
+    {
+        printf("Error: %s is not a journal this program can read\n", path);
+        unmapFile(&file);
+        return -2;
+    }
+    if (header->checkpoint != store->checkpointId)
+    {
+        int stale = header->checkpoint < store->checkpointId;
+        if (!stale)
+        {
+            printf("Error: Journal %s continues checkpoint %llu but snapshot %s is missing or "
+                   "older (checkpoint %llu); restore the snapshot or move the journal away\n",
+                   path, (unsigned long long) header->checkpoint, store->journal.snapshotPath,
+                   (unsigned long long) store->checkpointId);
+        }
+        unmapFile(&file);
+        return stale ? -1 : -2;
+    }
+
+    long applied = 0;
+    size_t offset = sizeof(JournalHeader);
+    const unsigned char *data = (const unsigned char *) file.data;
+    while (offset < file.size && validJournalRecord(data + offset, file.size - offset))
+    {
+        applyJournalRecord(store, (JournalOp) data[offset], data + offset + 2, data[offset + 1]);
+        offset += (size_t) data[offset + 1] + 6;
+        applied++;
+    }
+    *validEnd = offset;
+    unmapFile(&file);
+    return applied;
+}
+
+// Rebuilds the state from the last snapshot plus the journal, then keeps the journal open so
+// every later change is appended to it.
+int recoverState(AttendanceStore *store, const char *snapshotPath, const char *journalPath)
+{
+    snprintf(store->journal.snapshotPath, sizeof(store->journal.snapshotPath), "%s", snapshotPath);
+    snprintf(store->journal.path, sizeof(store->journal.path), "%s", journalPath);
+
+    int fromSnapshot = 0;
+    FILE *existing = fopen(snapshotPath, "rb");
+    if (existing)
+    {
+        fclose(existing);
+        if (loadSnapshot(store, snapshotPath) != 0)
+        {
+            return -1;
+        }
+        fromSnapshot = 1;
+    }
+
+    size_t validEnd;
+    long replayed = replayJournal(store, journalPath, &validEnd);
+    if (replayed == -2)
+    {
+        return -1;
+    }
+    if (replayed < 0)
+    {
+        if (resetJournal(store) != 0)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        store->journal.file = fopen(journalPath, "r+b");
+        if (!store->journal.file || fseek(store->journal.file, (long) validEnd, SEEK_SET) != 0)
+        {
+            printf("Error: Could not open journal %s\n", journalPath);
+            return -1;
+        }
+#if HAVE_POSIX
+        if (ftruncate(fileno(store->journal.file), (off_t) validEnd) != 0)
+        {
+            printf("Error: Could not truncate journal %s\n", journalPath);
+            return -1;
+        }
+#endif
+    }
+
+    if (fromSnapshot)
+    {
+        printf("Recovered %d students from %s and %ld journal records from %s\n",
+               store->hashTable.count, snapshotPath, replayed > 0 ? replayed : 0, journalPath);
+    }
+    else if (replayed > 0)
+    {
+        printf("Recovered %d students from %ld journal records in %s\n", store->hashTable.count,
+               replayed, journalPath);
+    }
+
+    store->journal.stopFlusher = 0;
+    store->journal.flusherRunning =
+        pthread_create(&store->journal.flusher, NULL, journalFlusher, store) == 0;
+    return 0;
+}
+
+// Folds the journal into a new snapshot and starts an empty journal for it.
+int checkpointState(AttendanceStore *store)
+{
+    if (!store->journal.file)
+    {
+        return 0;
+    }
+    journalCommit(store);
+    store->checkpointId++;
+    if (saveSnapshot(store, store->journal.snapshotPath) != 0)
+    {
+        store->checkpointId--;
+        return -1;
+    }
+    return resetJournal(store);
+}
+
+void closeJournal(AttendanceStore *store)
+{
+    if (store->journal.flusherRunning)
+    {
+        pthread_mutex_lock(&store->journal.lock);
+        store->journal.stopFlusher = 1;
+        pthread_cond_signal(&store->journal.wake);
+        pthread_mutex_unlock(&store->journal.lock);
+        pthread_join(store->journal.flusher, NULL);
+        store->journal.flusherRunning = 0;
+    }
+    journalWrite(store, 1);
+    pthread_mutex_lock(&store->journal.writeLock);
+    pthread_mutex_lock(&store->journal.lock);
+    if (store->journal.file)
+    {
+        fclose(store->journal.file);
+        store->journal.file = NULL;
+    }
+    pthread_mutex_unlock(&store->journal.lock);
+    pthread_mutex_unlock(&store->journal.writeLock);
+}
+
+// Closes the store's journal and frees everything it holds, the store included.
+void destroyStore(AttendanceStore *store)
+{
+    closeJournal(store);
+    freeHashTable(store);
+    for (int i = 0; i < TABLE_STRIPES; i++)
+    {
+        pthread_mutex_destroy(&store->tableStripes[i].lock);
+    }
+    pthread_mutex_destroy(&store->journal.lock);
+    pthread_mutex_destroy(&store->journal.writeLock);
+    pthread_cond_destroy(&store->journal.wake);
+    pthread_mutex_destroy(&store->server.connectionsLock);
+    free(store);
+}
+
+// Reads a whole status token: P/A, 1/0 or present/absent in any case. Returns -1 for anything
+// else, so "Pxyz" is not taken for present.
+static int parseAttendanceStatus(const char *token, int length)
+{
+    static const char *words[] = {"0", "1", "a", "p", "absent", "present"};
+    for (int i = 0; i < 6; i++)
+    {
+        int matched = 0;
+        while (matched < length && words[i][matched] &&
+               tolower((unsigned char) token[matched]) == words[i][matched])
+        {
+            matched++;
+        }
+        if (matched == length && words[i][matched] == '\0')
+        {
+            return i % 2;
+        }
+    }
+    return -1;
+}
+
+// Parses "id,subject,day,status" where status is P/A, 1/0 or present/absent in any case. The
+// subject index is cached in `lastSubject` so runs of the same subject cost one comparison.
+static int parseAttendanceLine(ImportSubjects *subjects, const char *line, const char *end,
+                               AttendanceTuple *tuple, int *lastSubject)
+{
+    const char *fields[4];
+    int lengths[4];
+    const char *p = line;
+    for (int f = 0; f < 4; f++)
+    {
+        fields[f] = p;
+        while (p < end && *p != ',' && *p != '\r')
+        {
+            p++;
+        }
+        lengths[f] = (int) (p - fields[f]);
+        if (f < 3)
+        {
+            if (p == end || *p != ',')
+            {
+                return 0;
+            }
+            p++;
+        }
+    }
+
+    long id = 0;
+    for (int i = 0; i < lengths[0]; i++)
+    {
+        char c = fields[0][i];
+        if (c < '0' || c > '9')
+        {
+            return 0;
+        }
+        id = id * 10 + (c - '0');
+        if (id > INT_MAX)
+        {
+            return 0;
+        }
+    }
+    int day = 0;
+    for (int i = 0; i < lengths[2]; i++)
+    {
+        char c = fields[2][i];
+        if (c < '0' || c > '9' || day > MAX_DAYS)
+        {
+            return 0;
+        }
+        day = day * 10 + (c - '0');
+    }
+    if (lengths[0] == 0 || day < 1 || day > MAX_DAYS || lengths[1] == 0 ||
+        lengths[1] >= MAX_NAME_LEN || lengths[3] == 0)
+    {
+        return 0;
+    }
+
+    int status = parseAttendanceStatus(fields[3], lengths[3]);
+    if (status < 0)
+    {
+        return 0;
+    }
+
+    if (*lastSubject < 0 || strncmp(subjects->names[*lastSubject], fields[1], lengths[1]) != 0 ||
+        subjects->names[*lastSubject][lengths[1]] != '\0')
+    {
+        char subject[MAX_NAME_LEN];
+        memcpy(subject, fields[1], (size_t) lengths[1]);
+        subject[lengths[1]] = '\0';
+        *lastSubject = -1;
+        for (int i = 0; i < subjects->count && *lastSubject < 0; i++)
+        {
+            if (strcmp(subjects->names[i], subject) == 0)
+            {
+                *lastSubject = i;
+            }
+        }
+        if (*lastSubject < 0)
+        {
+            if (subjects->count == MAX_SUBJECTS)
+            {
+                return 0;
+            }
+            memcpy(subjects->names[subjects->count], subject, (size_t) lengths[1] + 1);
+            *lastSubject = subjects->count++;
+        }
+    }
+    tuple->status = (signed char) status;
+    tuple->id = (int) id;
+    tuple->subject = (unsigned char) *lastSubject;
+    tuple->day = (unsigned char) (day - 1);
+    return 1;
+}
+
+// Applies a scanner/CSV export of attendance events. The tuples are parsed from the mapped file,
+// counting-sorted into (subject, day) groups while keeping file order within a group, and each
+// group is applied with one index probe per event, so the last event for a student wins.
+void importAttendance(AttendanceStore *store, const char *filename)
+{
+    MappedFile file;
+    double start = nowSeconds();
+    if (mapFile(filename, &file) != 0)
+    {
+        printf("Error: Could not open file %s\n", filename);
+        return;
+    }
+
+    long capacity = 4096, count = 0, invalid = 0, lineNumber = 0;
+    AttendanceTuple *tuples = (AttendanceTuple *) malloc(capacity * sizeof(AttendanceTuple));
+    long groupSizes[MAX_SUBJECTS * MAX_DAYS + 1] = {0};
+    if (!tuples)
+    {
+        printf("Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    ImportSubjects subjects;
+    memcpy(subjects.names, store->subjectList, sizeof(subjects.names));
+    subjects.known = subjects.count = store->subjectCount;
+    int lastSubject = -1;
+    const char *p = file.data;
+    const char *end = file.data + file.size;
+    while (p < end)
+    {
+        const char *lineEnd = memchr(p, '\n', (size_t) (end - p));
+        if (!lineEnd)
+        {
+            lineEnd = end;
+        }
+        lineNumber++;
+        if (count == capacity)
+        {
+            capacity *= 2;
+            tuples = (AttendanceTuple *) realloc(tuples, capacity * sizeof(AttendanceTuple));
+            if (!tuples)
+            {
+                printf("Error: Memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        AttendanceTuple *tuple = &tuples[count];
+        if (parseAttendanceLine(&subjects, p, lineEnd, tuple, &lastSubject))
+        {
+            groupSizes[tuple->subject * MAX_DAYS + tuple->day + 1]++;
+            count++;
+        }
+        else if (lineEnd > p && !(lineNumber == 1 && (*p < '0' || *p > '9')))
+        {
+            if (invalid++ < IMPORT_MAX_WARNINGS)
+            {
+                printf("Warning: Skipping invalid line %ld: %.*s\n", lineNumber,
+                       (int) (lineEnd - p), p);
+            }
+        }
+        p = lineEnd + 1;
+    }
+    unmapFile(&file);
+
+    // A file with invalid lines registers no new subjects, so a typo cannot use up a subject slot
+    // for good; the marks for its new subjects are skipped along with the invalid lines.
+    long dropped = 0;
+    if (invalid > 0 && subjects.count > subjects.known)
+    {
+        long kept = 0;
+        for (long i = 0; i < count; i++)
+        {
+            if (tuples[i].subject < subjects.known)
+            {
+                tuples[kept++] = tuples[i];
+            }
+            else
+            {
+                groupSizes[tuples[i].subject * MAX_DAYS + tuples[i].day + 1]--;
+                dropped++;
+            }
+        }
+        count = kept;
+    }
+    else
+    {
+        for (int i = subjects.known; i < subjects.count; i++)
+        {
+            getSubjectIndex(store, subjects.names[i]);
+        }
+    }
+
+    for (int g = 1; g <= MAX_SUBJECTS * MAX_DAYS; g++)
+    {
+        groupSizes[g] += groupSizes[g - 1];
+    }
+    size_t groupedSize = (count ? count : 1) * sizeof(AttendanceTuple);
+    AttendanceTuple *grouped = (AttendanceTuple *) malloc(groupedSize);
+    if (!grouped)
+    {
+        printf("Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (long i = 0; i < count; i++)
+    {
+        grouped[groupSizes[tuples[i].subject * MAX_DAYS + tuples[i].day]++] = tuples[i];
+    }
+    free(tuples);
+
+    long applied = 0, unresolved = 0;
+    journalBeginBulk(store);
+    for (long i = 0; i < count; i++)
+    {
+        int matches;
+        Student *student = lookupStudent(store, grouped[i].id, &matches);
+        if (student)
+        {
+            markStudent(store, student, grouped[i].subject, grouped[i].day, grouped[i].status);
+            applied++;
+        }
+        else
+        {
+            unresolved++;
+        }
+    }
+    free(grouped);
+    journalEndBulk(store);
+
+    double elapsed = nowSeconds() - start;
+    if (invalid > IMPORT_MAX_WARNINGS)
+    {
+        printf("Warning: %ld more invalid lines skipped\n", invalid - IMPORT_MAX_WARNINGS);
+    }
+    if (dropped > 0)
+    {
+        printf("Warning: Skipped %ld marks for subjects new to this file, which are not registered "
+               "while it has invalid lines:",
+               dropped);
+        for (int i = subjects.known; i < subjects.count; i++)
+        {
+            printf(" %s", subjects.names[i]);
+        }
+        printf("\n");
+    }
+    printf("Imported %ld attendance marks from %s in %.1f ms (%.0f marks/s)\n", applied, filename,
+           elapsed * 1e3, elapsed > 0 ? applied / elapsed : 0.0);
+    if (unresolved > 0)
+    {
+        printf("Skipped %ld marks for unknown or ambiguous student IDs\n", unresolved);
+    }
+}
+
+// Collects report text in a large buffer that is handed to stdio in few big writes. Numbers and
+// padded names are formatted by hand; callers reserve a whole line before writing it. A writer
+// without a file keeps everything in memory, growing its buffer as needed.
+typedef struct ReportWriter
+{
+    FILE *file;
+    char *buffer;
+    size_t used;
+    size_t capacity;
+    size_t bytes;
+} ReportWriter;
+
+static const char *reportFormatNames[] = {"text", "csv", "json"};
+static const char *reportExtensions[] = {".txt", ".csv", ".jsonl"};
+
+// One subject's part of a report run; the day range comes from the stripes' day counters.
+typedef struct ReportSection
+{
+    int subject;
+    const char *subjectName;
+    int minDay;
+    int maxDay;
+    ReportWriter writer;
+} ReportSection;
+
+static void openReportWriter(ReportWriter *writer, FILE *file)
+{
+    writer->file = file;
+    writer->buffer = (char *) malloc(REPORT_BUFFER_SIZE);
+    writer->used = 0;
+    writer->capacity = REPORT_BUFFER_SIZE;
+    writer->bytes = 0;
+    if (!writer->buffer)
+    {
+        printf("Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void flushReportWriter(ReportWriter *writer)
+{
+    fwrite(writer->buffer, 1, writer->used, writer->file);
+    writer->bytes += writer->used;
+    writer->used = 0;
+}
+
+static void reserveReportLine(ReportWriter *writer)
+{
+    if (writer->used + REPORT_MAX_LINE <= writer->capacity)
+    {
+        return;
+    }
+    if (writer->file)
+    {
+        flushReportWriter(writer);
+        return;
+    }
+    writer->capacity *= 2;
+    writer->buffer = (char *) realloc(writer->buffer, writer->capacity);
+    if (!writer->buffer)
+    {
+        printf("Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Copies formatted text from an in-memory writer, bypassing the buffer when it is large.
+static void appendReportText(ReportWriter *writer, const char *text, size_t length)
+{
+    if (writer->used + length > writer->capacity)
+    {
+        flushReportWriter(writer);
+    }
+    if (length > writer->capacity)
+    {
+        fwrite(text, 1, length, writer->file);
+        writer->bytes += length;
+        return;
+    }
+    memcpy(writer->buffer + writer->used, text, length);
+    writer->used += length;
+}
+
+// Flushes and closes the file; returns -1 if any write failed.
+static int closeReportWriter(ReportWriter *writer)
+{
+    flushReportWriter(writer);
+    int failed = ferror(writer->file) != 0;
+    failed |= fclose(writer->file) != 0;
+    free(writer->buffer);
+    writer->buffer = NULL;
+    return failed ? -1 : 0;
+}
+
+static void reportPutText(ReportWriter *writer, const char *text, int width)
+{
+    char *out = writer->buffer + writer->used;
+    while (*text)
+    {
+        *out++ = *text++;
+        width--;
+    }
+    while (width-- > 0)
+    {
+        *out++ = ' ';
+    }
+    writer->used = out - writer->buffer;
+}
+
+// Left-justified like "%-*d".
+static void reportPutInt(ReportWriter *writer, int value, int width)
+{
+    char digits[12];
+    int length = 0;
+    unsigned int magnitude = value < 0 ? 0u - (unsigned int) value : (unsigned int) value;
+    do
+    {
+        digits[length++] = (char) ('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+
+    char *out = writer->buffer + writer->used;
+    if (value < 0)
+    {
+        *out++ = '-';
+        width--;
+    }
+    width -= length;
+    while (length > 0)
+    {
+        *out++ = digits[--length];
+    }
+    while (width-- > 0)
+    {
+        *out++ = ' ';
+    }
+    writer->used = out - writer->buffer;
+}
+
+// Parses "all" or a comma-separated list of subject names; returns the count or -1.
+int parseSubjectSelection(AttendanceStore *store, char *list, int *subjects)
+{
+    if (strcmp(list, "all") == 0)
+    {
+        for (int i = 0; i < store->subjectCount; i++)
+        {
+            subjects[i] = i;
+        }
+        return store->subjectCount;
+    }
+    int count = 0;
+    char *saveptr;
+    for (char *name = strtok_r(list, ",", &saveptr); name; name = strtok_r(NULL, ",", &saveptr))
+    {
+        int subject = findSubjectIndex(store, name);
+        if (subject == -1)
+        {
+            printf("Error: Subject %s not found.\n", name);
+            return -1;
+        }
+        if (count < MAX_SUBJECTS)
+        {
+            subjects[count++] = subject;
+        }
+    }
+    return count;
+}
+
+static void writeReportHeader(ReportSection *section)
+{
+    ReportWriter *writer = &section->writer;
+    reserveReportLine(writer);
+    reportPutText(writer, section->subjectName, 0);
+    reportPutText(writer, " Attendance Report\n", 0);
+    reportPutText(writer, "ID", 11);
+    reportPutText(writer, "Name", 30);
+    for (int day = section->minDay; day <= section->maxDay; day++)
+    {
+        reportPutText(writer, " Day", 0);
+        reportPutInt(writer, day, 2);
+    }
+    reportPutText(writer, "\n", 0);
+    reportPutText(
+        writer,
+        "--------------------------------------------------------------------------------------\n",
+        0);
+}
+
+static void writeReportRow(ReportSection *section, const Student *student)
+{
+    ReportWriter *writer = &section->writer;
+    reserveReportLine(writer);
+    reportPutInt(writer, student->id, 10);
+    reportPutText(writer, " ", 0);
+    reportPutText(writer, student->name, 30);
+
+    uint32_t present = student->subjects[section->subject].present;
+    char *out = writer->buffer + writer->used;
+    for (int day = section->minDay; day <= section->maxDay; day++)
+    {
+        memcpy(out, present & (1u << (day - 1)) ? " P  " : " A  ", 4);
+        out += 4;
+    }
+    *out++ = '\n';
+    writer->used = out - writer->buffer;
+}
+
+// Writes a CSV field, quoting it only when it contains a comma, quote or line break.
+static void reportPutCsvField(ReportWriter *writer, const char *text)
+{
+    if (strpbrk(text, ",\"\r\n") == NULL)
+    {
+        reportPutText(writer, text, 0);
+        return;
+    }
+    char *out = writer->buffer + writer->used;
+    *out++ = '"';
+    for (; *text; text++)
+    {
+        if (*text == '"')
+        {
+            *out++ = '"';
+        }
+        *out++ = *text;
+    }
+    *out++ = '"';
+    writer->used = out - writer->buffer;
+}
+
+static void reportPutJsonString(ReportWriter *writer, const char *text)
+{
+    static const char hex[] = "0123456789abcdef";
+    char *out = writer->buffer + writer->used;
+    *out++ = '"';
+    for (; *text; text++)
+    {
+        unsigned char c = (unsigned char) *text;
+        if (c == '"' || c == '\\')
+        {
+            *out++ = '\\';
+            *out++ = (char) c;
+        }
+        else if (c < 0x20)
+        {
+            memcpy(out, "\\u00", 4);
+            out[4] = hex[c >> 4];
+            out[5] = hex[c & 15];
+            out += 6;
+        }
+        else
+        {
+            *out++ = (char) c;
+        }
+    }
+    *out++ = '"';
+    writer->used = out - writer->buffer;
+}
+
+// subject,id,name,present,recorded,percentage, then one column per day of the range.
+static void writeCsvHeader(ReportSection *section)
+{
+    ReportWriter *writer = &section->writer;
+    reserveReportLine(writer);
+    reportPutText(writer, "subject,id,name,present,recorded,percentage", 0);
+    for (int day = section->minDay; day <= section->maxDay; day++)
+    {
+        reportPutText(writer, ",day", 0);
+        reportPutInt(writer, day, 0);
+    }
+    reportPutText(writer, "\n", 0);
+}
+
+// Day cells are P, A or empty when nothing was recorded.
+static void writeCsvRow(ReportSection *section, const Student *student)
+{
+    ReportWriter *writer = &section->writer;
+    const AttendanceRecord *record = &student->subjects[section->subject];
+    AttendanceTotals totals = {popcount32(record->present), popcount32(record->recorded)};
+    reserveReportLine(writer);
+    reportPutCsvField(writer, section->subjectName);
+    reportPutText(writer, ",", 0);
+    reportPutInt(writer, student->id, 0);
+    reportPutText(writer, ",", 0);
+    reportPutCsvField(writer, student->name);
+    reportPutText(writer, ",", 0);
+    reportPutInt(writer, (int) totals.present, 0);
+    reportPutText(writer, ",", 0);
+    reportPutInt(writer, (int) totals.recorded, 0);
+    reportPutText(writer, ",", 0);
+    reportPutInt(writer, percentageOf(totals), 0);
+
+    char *out = writer->buffer + writer->used;
+    for (int day = section->minDay; day <= section->maxDay; day++)
+    {
+        uint32_t bit = 1u << (day - 1);
+        *out++ = ',';
+        if (record->recorded & bit)
+        {
+            *out++ = record->present & bit ? 'P' : 'A';
+        }
+    }
+    *out++ = '\n';
+    writer->used = out - writer->buffer;
+}
+
+// One object per student and subject; "days" maps each recorded day to "P" or "A".
+static void writeJsonRow(ReportSection *section, const Student *student)
+{
+    ReportWriter *writer = &section->writer;
+    const AttendanceRecord *record = &student->subjects[section->subject];
+    AttendanceTotals totals = {popcount32(record->present), popcount32(record->recorded)};
+    reserveReportLine(writer);
+    reportPutText(writer, "{\"subject\":", 0);
+    reportPutJsonString(writer, section->subjectName);
+    reportPutText(writer, ",\"id\":", 0);
+    reportPutInt(writer, student->id, 0);
+    reportPutText(writer, ",\"name\":", 0);
+    reportPutJsonString(writer, student->name);
+    reportPutText(writer, ",\"present\":", 0);
+    reportPutInt(writer, (int) totals.present, 0);
+    reportPutText(writer, ",\"recorded\":", 0);
+    reportPutInt(writer, (int) totals.recorded, 0);
+    reportPutText(writer, ",\"percentage\":", 0);
+    reportPutInt(writer, percentageOf(totals), 0);
+    reportPutText(writer, ",\"days\":{", 0);
+    const char *separator = "";
+    for (int day = section->minDay; day <= section->maxDay; day++)
+    {
+        uint32_t bit = 1u << (day - 1);
+        if (record->recorded & bit)
+        {
+            reportPutText(writer, separator, 0);
+            reportPutText(writer, "\"", 0);
+            reportPutInt(writer, day, 0);
+            reportPutText(writer, record->present & bit ? "\":\"P\"" : "\":\"A\"", 0);
+            separator = ",";
+        }
+    }
+    reportPutText(writer, "}}\n", 0);
+}
+
+int parseReportFormat(const char *name)
+{
+    for (int format = REPORT_TEXT; format <= REPORT_JSON; format++)
+    {
+        if (strcmp(name, reportFormatNames[format]) == 0)
+        {
+            return format;
+        }
+    }
+    printf("Error: Unknown report format %s (use text, csv or json)\n", name);
+    return -1;
+}
+
+// Appends a spooled section to the combined report and closes the spool.
+static int appendSection(ReportWriter *writer, ReportWriter *spool)
+{
+    size_t length;
+    flushReportWriter(spool);
+    flushReportWriter(writer);
+    rewind(spool->file);
+    while ((length = fread(spool->buffer, 1, REPORT_BUFFER_SIZE, spool->file)) > 0)
+    {
+        fwrite(spool->buffer, 1, length, writer->file);
+        writer->bytes += length;
+    }
+    spool->used = 0;
+    return closeReportWriter(spool);
+}
+
+// A contiguous range of the ID index, formatted by one worker into in-memory copies of the
+// report sections.
+typedef struct ReportShard
+{
+    const IdEntry *entries;
+    long firstEntry;
+    long endEntry;
+    int sectionCount;
+    void (*writeRow)(ReportSection *, const Student *);
+    ReportSection sections[MAX_SUBJECTS];
+} ReportShard;
+
+static void *formatReportShard(void *arg)
+{
+    ReportShard *shard = (ReportShard *) arg;
+    for (long entry = shard->firstEntry; entry < shard->endEntry; entry++)
+    {
+        Student *current = shard->entries[entry].student;
+        for (int i = 0; current && i < shard->sectionCount; i++)
+        {
+            shard->writeRow(&shard->sections[i], current);
+        }
+    }
+    return NULL;
+}
+
+// Writes every student's rows in ID order, read straight from the ordered index. Large rosters
+// are cut into rounds of consecutive index ranges, one per worker; each worker formats its range
+// into memory and the results are appended shard by shard, so the output matches a serial pass
+// byte for byte and memory is bounded by one round.
+static void writeReportRows(AttendanceStore *store, ReportSection *sections, int sectionCount,
+                            void (*writeRow)(ReportSection *, const Student *))
+{
+    int threads = resolveThreadCount(store);
+    prepareIdIndex(store);
+    long entries = store->idIndex.sortedCount;
+    if (threads == 1 || entries <= REPORT_SHARD_STUDENTS)
+    {
+        for (long entry = 0; entry < entries; entry++)
+        {
+            Student *current = store->idIndex.entries[entry].student;
+            for (int i = 0; current && i < sectionCount; i++)
+            {
+                writeRow(&sections[i], current);
+            }
+        }
+        return;
+    }
+
+    ReportShard *shards = (ReportShard *) malloc(threads * sizeof(ReportShard));
+    pthread_t workers[MAX_WORKER_THREADS];
+    if (!shards)
+    {
+        printf("Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int t = 0; t < threads; t++)
+    {
+        shards[t].entries = store->idIndex.entries;
+        shards[t].sectionCount = sectionCount;
+        shards[t].writeRow = writeRow;
+        for (int i = 0; i < sectionCount; i++)
+        {
+            shards[t].sections[i] = sections[i];
+            openReportWriter(&shards[t].sections[i].writer, NULL);
+        }
+    }
+
+    for (long round = 0; round < entries; round += (long) threads * REPORT_SHARD_STUDENTS)
+    {
+        int shardCount = 0;
+        int started[MAX_WORKER_THREADS] = {0};
+        while (shardCount < threads && round + shardCount * REPORT_SHARD_STUDENTS < entries)
+        {
+            ReportShard *shard = &shards[shardCount];
+            shard->firstEntry = round + shardCount * REPORT_SHARD_STUDENTS;
+            shard->endEntry = shard->firstEntry + REPORT_SHARD_STUDENTS;
+            if (shard->endEntry > entries)
+            {
+                shard->endEntry = entries;
+            }
+            if (shardCount > 0)
+            {
+                started[shardCount] =
+                    pthread_create(&workers[shardCount], NULL, formatReportShard, shard) == 0;
+            }
+            shardCount++;
+        }
+        for (int t = 0; t < shardCount; t++)
+        {
+            if (started[t])
+            {
+                pthread_join(workers[t], NULL);
+            }
+            else
+            {
+                formatReportShard(&shards[t]);
+            }
+            for (int i = 0; i < sectionCount; i++)
+            {
+                ReportWriter *shardWriter = &shards[t].sections[i].writer;
+                appendReportText(&sections[i].writer, shardWriter->buffer, shardWriter->used);
+                shardWriter->used = 0;
+            }
+        }
+    }
+
+    for (int t = 0; t < threads; t++)
+    {
+        for (int i = 0; i < sectionCount; i++)
+        {
+            free(shards[t].sections[i].writer.buffer);
+        }
+    }
+    free(shards);
+}
+
+// Writes the reports for several subjects in one traversal of the table. With `combined` all
+// sections go to `target`, the later ones spooled through temporary files so they stay in order;
+// otherwise each subject goes to its own file named `target` + subject + the format's extension.
+// A combined CSV report is one table, so every section uses the union of the day ranges.
+int generateReports(AttendanceStore *store, const int *subjects, int count, const char *target,
+                    int combined, ReportFormat format)
+{
+    ReportSection sections[MAX_SUBJECTS];
+    char filenames[MAX_SUBJECTS][MAX_PATH_LEN];
+    int sectionCount = 0;
+    for (int i = 0; i < count && sectionCount < MAX_SUBJECTS; i++)
+    {
+        ReportSection *section = &sections[sectionCount];
+        section->subject = subjects[i];
+        section->subjectName = store->subjectList[subjects[i]];
+        section->minDay = MAX_DAYS + 1;
+        section->maxDay = 0;
+        for (int day = 0; day < MAX_DAYS; day++)
+        {
+            if (dayRecordCount(store, subjects[i], day) > 0)
+            {
+                if (day + 1 < section->minDay)
+                    section->minDay = day + 1;
+                section->maxDay = day + 1;
+            }
+        }
+        if (section->minDay > section->maxDay)
+        {
+            printf("No attendance data available for subject %s.\n",
+                   store->subjectList[subjects[i]]);
+            continue;
+        }
+        if (combined)
+        {
+            snprintf(filenames[sectionCount], MAX_PATH_LEN, "%s", target);
+        }
+        else
+        {
+            snprintf(filenames[sectionCount], MAX_PATH_LEN, "%s%s%s", target,
+                     store->subjectList[subjects[i]], reportExtensions[format]);
+        }
+        sectionCount++;
+    }
+    if (sectionCount == 0)
+    {
+        return 0;
+    }
+    for (int i = 1; combined && format == REPORT_CSV && i < sectionCount; i++)
+    {
+        if (sections[i].minDay < sections[0].minDay)
+            sections[0].minDay = sections[i].minDay;
+        if (sections[i].maxDay > sections[0].maxDay)
+            sections[0].maxDay = sections[i].maxDay;
+    }
+    for (int i = 1; combined && format == REPORT_CSV && i < sectionCount; i++)
+    {
+        sections[i].minDay = sections[0].minDay;
+        sections[i].maxDay = sections[0].maxDay;
+    }
+
+    for (int i = 0; i < sectionCount; i++)
+    {
+        FILE *file = combined && i > 0 ? tmpfile() : fopen(filenames[i], "w");
+        if (!file)
+        {
+            printf("Error: Could not open file %s for writing\n", filenames[i]);
+            for (int j = 0; j < i; j++)
+            {
+                closeReportWriter(&sections[j].writer);
+            }
+            return -1;
+        }
+        openReportWriter(&sections[i].writer, file);
+    }
+
+    void (*writeRow)(ReportSection *, const Student *) = writeReportRow;
+    for (int i = 0; i < sectionCount; i++)
+    {
+        if (format == REPORT_TEXT)
+        {
+            writeReportHeader(&sections[i]);
+        }
+        else if (format == REPORT_CSV && (!combined || i == 0))
+        {
+            writeCsvHeader(&sections[i]);
+        }
+    }
+    if (format != REPORT_TEXT)
+    {
+        writeRow = format == REPORT_CSV ? writeCsvRow : writeJsonRow;
+    }
+
+    writeReportRows(store, sections, sectionCount, writeRow);
+
+    int failed = 0;
+    for (int i = 1; combined && i < sectionCount; i++)
+    {
+        if (format == REPORT_TEXT)
+        {
+            reserveReportLine(&sections[0].writer);
+            reportPutText(&sections[0].writer, "\n", 0);
+        }
+        failed |= appendSection(&sections[0].writer, &sections[i].writer);
+    }
+    for (int i = 0; i < (combined ? 1 : sectionCount); i++)
+    {
+        failed |= closeReportWriter(&sections[i].writer);
+    }
+    if (failed)
+    {
+        printf("Error: Could not write report to %s\n", target);
+        return -1;
+    }
+    for (int i = 0; i < sectionCount && !store->quiet; i++)
+    {
+        printf("Attendance report for %s generated successfully in %s\n",
+               store->subjectList[sections[i].subject], filenames[i]);
+    }
+    return 0;
+}
+
+void generateReport(AttendanceStore *store, const char *filename, const char *subject)
+{
+    int subjectIndex = findSubjectIndex(store, subject);
+    if (subjectIndex == -1)
+    {
+        printf("Error: Subject %s not found.\n", subject);
+        return;
+    }
+    generateReports(store, &subjectIndex, 1, filename, 1, REPORT_TEXT);
+}
+
+// Overall totals come from the running counters, a single subject from two popcounts.
+AttendanceTotals rankingTotals(const Student *student, int subjectIndex)
+{
+    if (subjectIndex < 0)
+    {
+        return student->totals;
+    }
+    const AttendanceRecord *record = &student->subjects[subjectIndex];
+    AttendanceTotals totals = {popcount32(record->present), popcount32(record->recorded)};
+    return totals;
+}
+
+// Compares exact attendance ratios by cross-multiplying, so 2/3 and 4/6 tie.
+static int compareAttendanceRatio(const RankedStudent *x, const RankedStudent *y)
+{
+    long lhs = x->totals.present * y->totals.recorded;
+    long rhs = y->totals.present * x->totals.recorded;
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+static int compareRankedIds(const RankedStudent *x, const RankedStudent *y)
+{
+    return (x->student->id > y->student->id) - (x->student->id < y->student->id);
+}
+
+// Orders by exact attendance ratio, lowest first, then by ID.
+static int compareRankedStudents(const void *a, const void *b)
+{
+    const RankedStudent *x = (const RankedStudent *) a;
+    const RankedStudent *y = (const RankedStudent *) b;
+    int order = compareAttendanceRatio(x, y);
+    return order ? order : compareRankedIds(x, y);
+}
+
+// Highest ratio first, then by ID.
+int compareHighestFirst(const void *a, const void *b)
+{
+    const RankedStudent *x = (const RankedStudent *) a;
+    const RankedStudent *y = (const RankedStudent *) b;
+    int order = compareAttendanceRatio(y, x);
+    return order ? order : compareRankedIds(x, y);
+}
+
+// Collects the students below `threshold` percent, overall or in one subject when
+// subjectIndex >= 0, sorted lowest first. Students with nothing recorded are left out.
+static long findStudentsBelow(AttendanceStore *store, int threshold, int subjectIndex,
+                              RankedStudent **results)
+{
+    long count = 0, capacity = 64;
+    RankedStudent *ranked = (RankedStudent *) malloc(capacity * sizeof(RankedStudent));
+    if (!ranked)
+    {
+        printf("Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    StudentCursor cursor;
+    for (Student *current = firstStudent(store, &cursor); current != NULL;
+         current = nextStudent(store, &cursor))
+    {
+        AttendanceTotals totals = rankingTotals(current, subjectIndex);
+        if (!isBelowThreshold(totals, threshold))
+        {
+            continue;
+        }
+        if (count == capacity)
+        {
+            capacity *= 2;
+            ranked = (RankedStudent *) realloc(ranked, capacity * sizeof(RankedStudent));
+            if (!ranked)
+            {
+                printf("Error: Memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        ranked[count].student = current;
+        ranked[count].totals = totals;
+        count++;
+    }
+    qsort(ranked, count, sizeof(RankedStudent), compareRankedStudents);
+    *results = ranked;
+    return count;
+}
+
+static void printRankedStudents(const char *title, const RankedStudent *ranked, long count,
+                                int useColor)
+{
+    const char *heading = useColor ? BOLD BLUE : "";
+    const char *alert = useColor ? RED : "";
+    const char *reset = useColor ? RESET : "";
+    printf("%s%s%s\n", heading, title, reset);
+    printf("%-6s %-10s %-30s %-9s %s\n", "Rank", "ID", "Name", "Attended", "Percentage");
+    for (long i = 0; i < count; i++)
+    {
+        AttendanceTotals totals = ranked[i].totals;
+        printf("%-6ld %-10d %-30s %4ld/%-4ld %s%d%%%s\n", i + 1, ranked[i].student->id,
+               ranked[i].student->name, totals.present, totals.recorded,
+               isBelowThreshold(totals, ATTENDANCE_THRESHOLD) ? alert : "", percentageOf(totals),
+               reset);
+    }
+    printf("%ld student%s listed.\n", count, count == 1 ? "" : "s");
+}
+
+// Writes a ranking as a text table, CSV or JSON lines through the buffered report writer.
+static int writeRankingReport(AttendanceStore *store, const char *filename, const char *title,
+                              const RankedStudent *ranked, long count, int subjectIndex,
+                              ReportFormat format)
+{
+    FILE *file = fopen(filename, "w");
+    if (!file)
+    {
+        printf("Error: Could not open file %s for writing\n", filename);
+        return -1;
+    }
+    ReportWriter writer;
+    openReportWriter(&writer, file);
+    const char *subject = subjectIndex < 0 ? "all" : store->subjectList[subjectIndex];
+
+    reserveReportLine(&writer);
+    if (format == REPORT_TEXT)
+    {
+        reportPutText(&writer, title, 0);
+        reportPutText(&writer, "\nRank   ID         Name                           Present Recorded "
+                               "Percentage\n", 0);
+    }
+    else if (format == REPORT_CSV)
+    {
+        reportPutText(&writer, "rank,id,name,subject,present,recorded,percentage\n", 0);
+    }
+    for (long i = 0; i < count; i++)
+    {
+        const Student *student = ranked[i].student;
+        AttendanceTotals totals = ranked[i].totals;
+        reserveReportLine(&writer);
+        if (format == REPORT_TEXT)
+        {
+            reportPutInt(&writer, (int) (i + 1), 7);
+            reportPutInt(&writer, student->id, 11);
+            reportPutText(&writer, student->name, 31);
+            reportPutInt(&writer, (int) totals.present, 8);
+            reportPutInt(&writer, (int) totals.recorded, 9);
+            reportPutInt(&writer, percentageOf(totals), 0);
+            reportPutText(&writer, "%\n", 0);
+        }
+        else if (format == REPORT_CSV)
+        {
+            reportPutInt(&writer, (int) (i + 1), 0);
+            reportPutText(&writer, ",", 0);
+            reportPutInt(&writer, student->id, 0);
+            reportPutText(&writer, ",", 0);
+            reportPutCsvField(&writer, student->name);
+            reportPutText(&writer, ",", 0);
+            reportPutCsvField(&writer, subject);
+            reportPutText(&writer, ",", 0);
+            reportPutInt(&writer, (int) totals.present, 0);
+            reportPutText(&writer, ",", 0);
+            reportPutInt(&writer, (int) totals.recorded, 0);
+            reportPutText(&writer, ",", 0);
+            reportPutInt(&writer, percentageOf(totals), 0);
+            reportPutText(&writer, "\n", 0);
+        }
+        else
+        {
+            reportPutText(&writer, "{\"rank\":", 0);
+            reportPutInt(&writer, (int) (i + 1), 0);
+            reportPutText(&writer, ",\"id\":", 0);
+            reportPutInt(&writer, student->id, 0);
+            reportPutText(&writer, ",\"name\":", 0);
+            reportPutJsonString(&writer, student->name);
+            reportPutText(&writer, ",\"subject\":", 0);
+            reportPutJsonString(&writer, subject);
+            reportPutText(&writer, ",\"present\":", 0);
+            reportPutInt(&writer, (int) totals.present, 0);
+            reportPutText(&writer, ",\"recorded\":", 0);
+            reportPutInt(&writer, (int) totals.recorded, 0);
+            reportPutText(&writer, ",\"percentage\":", 0);
+            reportPutInt(&writer, percentageOf(totals), 0);
+            reportPutText(&writer, "}\n", 0);
+        }
+    }
+    if (closeReportWriter(&writer) != 0)
+    {
+        printf("Error: Could not write report to %s\n", filename);
+        return -1;
+    }
+    printf("Wrote %ld students to %s\n", count, filename);
+    return 0;
+}
+
+// Resolves a query's subject argument: missing or "all" means overall (-1).
+static int parseQuerySubject(AttendanceStore *store, const char *subject, int *subjectIndex)
+{
+    *subjectIndex = -1;
+    if (subject && strcmp(subject, "all") != 0)
+    {
+        *subjectIndex = findSubjectIndex(store, subject);
+        if (*subjectIndex == -1)
+        {
+            printf("Error: Subject %s not found.\n", subject);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Prints a ranking, or writes it as a report in `format` when `filename` is given.
+static int outputRanking(AttendanceStore *store, const char *title, const RankedStudent *ranked,
+                         long count, int subjectIndex, const char *filename, ReportFormat format,
+                         int useColor)
+{
+    if (filename)
+    {
+        return writeRankingReport(store, filename, title, ranked, count, subjectIndex, format);
+    }
+    printRankedStudents(title, ranked, count, useColor);
+    return 0;
+}
+
+// Lists the students under `threshold` percent, overall or in `subject` ("all" for overall),
+// on stdout or, when `filename` is given, as a report in `format`.
+int reportStudentsBelow(AttendanceStore *store, int threshold, const char *subject,
+                        const char *filename, ReportFormat format, int useColor)
+{
+    int subjectIndex;
+    if (threshold < 0 || threshold > 100)
+    {
+        printf("Error: Threshold must be between 0 and 100.\n");
+        return -1;
+    }
+    if (parseQuerySubject(store, subject, &subjectIndex) != 0)
+    {
+        return -1;
+    }
+
+    char title[MAX_NAME_LEN + 32];
+    snprintf(title, sizeof(title), "Students below %d%% in %.*s", threshold, MAX_NAME_LEN - 1,
+             subjectIndex < 0 ? "all subjects" : store->subjectList[subjectIndex]);
+    RankedStudent *ranked;
+    long count = findStudentsBelow(store, threshold, subjectIndex, &ranked);
+    int result = outputRanking(store, title, ranked, count, subjectIndex, filename, format,
+                               useColor);
+    free(ranked);
+    return result;
+}
+
+// True when `a` is listed before `b`: higher ratio first for a top ranking, lower for a bottom one.
+static int ranksBefore(const RankedStudent *a, const RankedStudent *b, int highest)
+{
+    return (highest ? compareHighestFirst(a, b) : compareRankedStudents(a, b)) < 0;
+}
+
+// Restores the heap below `index`; the root is the entry listed last, i.e. the first to evict.
+static void siftRankingHeap(RankedStudent *heap, long count, long index, int highest)
+{
+    for (;;)
+    {
+        long child = 2 * index + 1;
+        if (child >= count)
+        {
+            return;
+        }
+        if (child + 1 < count && ranksBefore(&heap[child], &heap[child + 1], highest))
+        {
+            child++;
+        }
+        if (!ranksBefore(&heap[index], &heap[child], highest))
+        {
+            return;
+        }
+        RankedStudent swap = heap[index];
+        heap[index] = heap[child];
+        heap[child] = swap;
+        index = child;
+    }
+}
+
+// Finds the k best (highest) or worst attended students, overall or in one subject, with a
+// k-entry heap so a pass over n students costs O(n log k) instead of a full sort. Students with
+// nothing recorded are skipped. `results` must hold k entries; returns how many were filled,
+// in listing order.
+long rankStudents(AttendanceStore *store, long k, int subjectIndex, int highest,
+                  RankedStudent *results)
+{
+    long count = 0;
+    StudentCursor cursor;
+    for (Student *current = firstStudent(store, &cursor); current != NULL && k > 0;
+         current = nextStudent(store, &cursor))
+    {
+        RankedStudent candidate = {current, rankingTotals(current, subjectIndex)};
+        if (candidate.totals.recorded == 0)
+        {
+            continue;
+        }
+        if (count < k)
+        {
+            results[count++] = candidate;
+            if (count == k)
+            {
+                for (long i = k / 2 - 1; i >= 0; i--)
+                {
+                    siftRankingHeap(results, k, i, highest);
+                }
+            }
+        }
+        else if (ranksBefore(&candidate, &results[0], highest))
+        {
+            results[0] = candidate;
+            siftRankingHeap(results, k, 0, highest);
+        }
+    }
+    qsort(results, count, sizeof(RankedStudent),
+          highest ? compareHighestFirst : compareRankedStudents);
+    return count;
+}
+
+int reportRanking(AttendanceStore *store, long k, int highest, const char *subject,
+                  const char *filename, ReportFormat format, int useColor)
+{
+    int subjectIndex;
+    if (k <= 0)
+    {
+        printf("Error: K must be a positive number.\n");
+        return -1;
+    }
+    if (parseQuerySubject(store, subject, &subjectIndex) != 0)
+    {
+        return -1;
+    }
+    if (k > store->hashTable.count)
+    {
+        k = store->hashTable.count > 0 ? store->hashTable.count : 1;
+    }
+
+    RankedStudent *ranked = (RankedStudent *) malloc(k * sizeof(RankedStudent));
+    if (!ranked)
+    {
+        printf("Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    char title[MAX_NAME_LEN + 48];
+    snprintf(title, sizeof(title), "%s %ld students by attendance in %.*s",
+             highest ? "Top" : "Bottom", k, MAX_NAME_LEN - 1,
+             subjectIndex < 0 ? "all subjects" : store->subjectList[subjectIndex]);
+    long count = rankStudents(store, k, subjectIndex, highest, ranked);
+    int result = outputRanking(store, title, ranked, count, subjectIndex, filename, format,
+                               useColor);
+    free(ranked);
+    return result;
+}
+
+uint32_t generatorRandom(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+// Synthetic rosters and attendance streams for benchmarking at any size. Everything derives from
+// a seed, so a marks file for a roster can be generated later without reading the roster back.
+static const char *generatorFirstNames[] = {
+    "Om", "Jay", "Diya", "Aarav", "Kabir", "Ananya", "Tanmay", "Ruhani", "Vanshika", "Hriday",
+    "Stuti", "Ishaan", "Saanvi", "Pranavkumar", "Tanushree", "Zoya", "Arjun", "Meera", "Rudra",
+    "Janvi", "Mohammed", "Aditi", "Siddharth", "Lakshmi", "Venkatesh", "Noor", "Kunal", "Priya"};
+static const char *generatorMiddleNames[] = {"Kumar", "Nitin", "Suhas", "Devi",
+                                             "Prasad", "Rani", "Mohan", "Lal",
+                                             "Singh", "Bai", "Chandra", "Narayan"};
+static const char *generatorLastNames[] = {
+    "Jain", "Das", "Iyer", "Khan", "Bose", "Sharma", "Singal", "Kshirsagar", "Gupta", "Reddy",
+    "Patel", "Menon", "Verma", "Chauhan", "Srivastava", "Dwivedi", "Patidar", "Goyal", "Rao",
+    "Venkataraghavan", "Chattopadhyay", "Nair", "Mukherjee", "Ramakrishnan", "Shah", "Ali"};
+const char *generatorSubjects[MAX_SUBJECTS] = {"DSA", "OS", "DBMS", "CN", "MATHS",
+                                               "PHYSICS", "AI", "COMPILERS", "SE", "ETHICS"};
+
+// Fills ids[0..count) with IDs from the 5900xxxxx series in ascending order. Students come in
+// cohorts that each own a block of 10,000 IDs and skip a few numbers here and there, so
+// different cohorts reuse the same last four digits the way real intakes do.
+static void generateStudentIds(int *ids, int count, uint32_t seed)
+{
+    int cohorts = (count + GENERATOR_COHORT_STUDENTS - 1) / GENERATOR_COHORT_STUDENTS;
+    cohorts = cohorts > GENERATOR_MAX_STUDENTS / ID_SUFFIX_SLOTS
+                  ? GENERATOR_MAX_STUDENTS / ID_SUFFIX_SLOTS
+                  : cohorts;
+    int perCohort = (count + cohorts - 1) / cohorts;
+    int next = 0;
+    for (int cohort = 0; next < count; cohort++)
+    {
+        int base = 590000000 + cohort * ID_SUFFIX_SLOTS;
+        int spare = ID_SUFFIX_SLOTS - perCohort;
+        int serial = (int) (generatorRandom(&seed) % (uint32_t) (spare / 4 + 1));
+        spare -= serial;
+        for (int i = 0; i < perCohort && next < count; i++)
+        {
+            uint32_t r = generatorRandom(&seed);
+            if (spare > 0 && r % 4 == 0)
+            {
+                int gap = 1 + (int) ((r >> 8) % 3);
+                gap = gap < spare ? gap : spare;
+                serial += gap;
+                spare -= gap;
+            }
+            ids[next++] = base + serial++;
+        }
+    }
+}
+
+// A first name, sometimes a middle name and a surname, now and then a double-barrelled one.
+// About one name in five is all capitals, as registrar exports often are.
+static void generateStudentName(char *name, uint32_t *seed)
+{
+    uint32_t firstCount = sizeof(generatorFirstNames) / sizeof(generatorFirstNames[0]);
+    uint32_t middleCount = sizeof(generatorMiddleNames) / sizeof(generatorMiddleNames[0]);
+    uint32_t lastCount = sizeof(generatorLastNames) / sizeof(generatorLastNames[0]);
+    uint32_t r = generatorRandom(seed);
+    int length = snprintf(name, MAX_NAME_LEN, "%s",
+                          generatorFirstNames[generatorRandom(seed) % firstCount]);
+    if (r % 10 < 3)
+    {
+        length += snprintf(name + length, MAX_NAME_LEN - length, " %s",
+                           generatorMiddleNames[generatorRandom(seed) % middleCount]);
+    }
+    uint32_t last = generatorRandom(seed) % lastCount;
+    length += snprintf(name + length, MAX_NAME_LEN - length, " %s", generatorLastNames[last]);
+    if ((r >> 8) % 20 == 0 && length < MAX_NAME_LEN - 1)
+    {
+        last = (last + 1 + generatorRandom(seed) % (lastCount - 1)) % lastCount;
+        snprintf(name + length, MAX_NAME_LEN - length, "-%s", generatorLastNames[last]);
+    }
+    if ((r >> 16) % 5 == 0)
+    {
+        for (char *c = name; *c; c++)
+        {
+            *c = (char) toupper((unsigned char) *c);
+        }
+    }
+}
+
+// Each student's own chance of being present, 50-99%, so percentages spread around the threshold.
+int generatedAttendanceRate(int id)
+{
+    return 50 + hashFunction(id, 1 << 16) % 50;
+}
+
+int *generateRosterIds(int count, uint32_t seed)
+{
+    if (count <= 0 || count > GENERATOR_MAX_STUDENTS)
+    {
+        printf("Error: Generated rosters hold 1 to %d students.\n", GENERATOR_MAX_STUDENTS);
+        return NULL;
+    }
+    int *ids = (int *) malloc((size_t) count * sizeof(int));
+    if (!ids)
+    {
+        printf("Error: Memory allocation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+    generateStudentIds(ids, count, seed);
+    return ids;
+}
+
+// Writes a roster of `count` generated students in the students.txt format.
+int writeGeneratedRoster(const char *filename, int count, uint32_t seed, RosterStats *stats)
+{
+    int *ids = generateRosterIds(count, seed);
+    if (!ids)
+    {
+        return -1;
+    }
+    FILE *file = fopen(filename, "w");
+    if (!file)
+    {
+        printf("Error: Could not open file %s for writing\n", filename);
+        free(ids);
+        return -1;
+    }
+    int *suffixCounts = (int *) calloc(ID_SUFFIX_SLOTS, sizeof(int));
+    if (!suffixCounts)
+    {
+        printf("Error: Memory allocation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+    RosterStats summary = {ids[0], ids[count - 1], 0, 0, MAX_NAME_LEN, 0, 0};
+    uint32_t nameSeed = seed ^ 0x5bd1e995u;
+    char name[MAX_NAME_LEN];
+    long nameBytes = 0;
+    for (int i = 0; i < count; i++)
+    {
+        generateStudentName(name, &nameSeed);
+        fprintf(file, "%d,%s\n", ids[i], name);
+        int length = (int) strlen(name);
+        nameBytes += length;
+        summary.shortestName = length < summary.shortestName ? length : summary.shortestName;
+        summary.longestName = length > summary.longestName ? length : summary.longestName;
+        suffixCounts[suffixSlot(ids[i])]++;
+    }
+    int failed = fclose(file) != 0;
+    for (int slot = 0; slot < ID_SUFFIX_SLOTS; slot++)
+    {
+        int chain = suffixCounts[slot];
+        if (chain > summary.longestSuffixChain)
+        {
+            summary.longestSuffixChain = chain;
+        }
+        summary.sharedSuffixes += chain > 1 ? chain : 0;
+    }
+    summary.meanName = (double) nameBytes / count;
+    if (stats)
+    {
+        *stats = summary;
+    }
+    free(suffixCounts);
+    free(ids);
+    if (failed)
+    {
+        printf("Error: Could not write %s\n", filename);
+    }
+    return failed ? -1 : 0;
+}
+
+// Writes `marks` attendance events in the import format for the roster writeGeneratedRoster makes
+// from the same `students` and `seed`, over the first `subjects` generated subjects. Days advance
+// through the month along the stream and about one mark in fifty revisits an earlier day.
+int writeGeneratedMarks(const char *filename, int students, long marks, int subjects,
+                        uint32_t seed)
+{
+    int *ids = generateRosterIds(students, seed);
+    if (!ids)
+    {
+        return -1;
+    }
+    FILE *file = fopen(filename, "w");
+    if (!file)
+    {
+        printf("Error: Could not open file %s for writing\n", filename);
+        free(ids);
+        return -1;
+    }
+    uint32_t state = seed ^ 0x9e3779b9u;
+    fprintf(file, "id,subject,day,status\n");
+    for (long i = 0; i < marks; i++)
+    {
+        int id = ids[generatorRandom(&state) % (uint32_t) students];
+        uint32_t r = generatorRandom(&state);
+        int day = (int) (i * MAX_DAYS / marks) + 1;
+        if (r % 50 == 0 && day > 1)
+        {
+            day -= 1 + (int) ((r >> 20) % (uint32_t) (day - 1));
+        }
+        int present = (int) ((r >> 8) % 100) < generatedAttendanceRate(id);
+        fprintf(file, "%d,%s,%d,%c\n", id, generatorSubjects[(r >> 4) % (uint32_t) subjects], day,
+                present ? 'P' : 'A');
+    }
+    int failed = fclose(file) != 0;
+    free(ids);
+    if (failed)
+    {
+        printf("Error: Could not write %s\n", filename);
+    }
+    return failed ? -1 : 0;
+}
+
+// Runs one request and writes its reply frame to `response`; returns the reply's size.
+static size_t handleServerRequest(AttendanceStore *store, const unsigned char *request,
+                                  size_t length, unsigned char *response)
+{
+    unsigned char *payload = response + 3;
+    size_t size = 0;
+    int status = SERVER_BAD_REQUEST;
+    int32_t id;
+
+    switch (request[0])
+    {
+    case SERVER_PING:
+        status = SERVER_OK;
+        break;
+    case SERVER_SUBJECT:
+        if (length >= 2 && length <= MAX_NAME_LEN && !memchr(request + 1, '\0', length - 1))
+        {
+            char subject[MAX_NAME_LEN];
+            memcpy(subject, request + 1, length - 1);
+            subject[length - 1] = '\0';
+            int subjectIndex = concurrentSubjectIndex(store, subject);
+            status = subjectIndex < 0 ? SERVER_FAILED : SERVER_OK;
+            payload[size++] = (unsigned char) subjectIndex;
+        }
+        break;
+    case SERVER_MARK:
+        if (length == 8 && (int8_t) request[7] >= -1 && (int8_t) request[7] <= 1)
+        {
+            memcpy(&id, request + 1, sizeof(id));
+            int result = concurrentMark(store, id, request[5], request[6] - 1, (int8_t) request[7]);
+            status = result == 0 ? SERVER_OK : result == -1 ? SERVER_NOT_FOUND
+                                                            : SERVER_BAD_REQUEST;
+        }
+        break;
+    case SERVER_VIEW:
+        if (length == 5)
+        {
+            Student student;
+            memcpy(&id, request + 1, sizeof(id));
+            status = SERVER_NOT_FOUND;
+            if (concurrentView(store, id, &student) == 0)
+            {
+                size_t nameLength = strlen(student.name);
+                memcpy(payload, &id, sizeof(id));
+                size = sizeof(id);
+                payload[size++] = (unsigned char) nameLength;
+                memcpy(payload + size, student.name, nameLength);
+                size += nameLength;
+                memcpy(payload + size, student.subjects, sizeof(student.subjects));
+                size += sizeof(student.subjects);
+                status = SERVER_OK;
+            }
+        }
+        break;
+    case SERVER_REPORT:
+        // Clients only name a file in the report directory, never a path of their own choosing.
+        if (length >= 4 && length - 3 < MAX_PATH_LEN && request[1] <= REPORT_JSON &&
+            !memchr(request + 3, '\0', length - 3) && !memchr(request + 3, '/', length - 3))
+        {
+            char name[MAX_PATH_LEN];
+            char path[MAX_PATH_LEN];
+            memcpy(name, request + 3, length - 3);
+            name[length - 3] = '\0';
+            if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0 ||
+                snprintf(path, sizeof(path), "%s/%s", store->server.reportDir, name) >=
+                    (int) sizeof(path))
+            {
+                break;
+            }
+            int subjects[MAX_SUBJECTS];
+            int count = 0;
+            // A report reads every student, so it holds every stripe for a consistent picture.
+            lockAllStripes(store);
+            for (int i = 0; i < store->subjectCount; i++)
+            {
+                if (request[2] == 255 || request[2] == i)
+                {
+                    subjects[count++] = i;
+                }
+            }
+            int failed = count ? generateReports(store, subjects, count, path, 1, request[1]) : 0;
+            unlockAllStripes(store);
+            status = !count ? SERVER_BAD_REQUEST : failed ? SERVER_FAILED : SERVER_OK;
+        }
+        break;
+    }
+
+    uint16_t frameLength = (uint16_t) (size + 1);
+    memcpy(response, &frameLength, sizeof(frameLength));
+    response[2] = (unsigned char) status;
+    return size + 3;
+}
+
+#if HAVE_EPOLL
+// One client. The epoll registration is one-shot, so only the worker that was woken for a
+// connection touches it until that worker re-arms it. The lock is therefore never contended; it
+// makes the hand-over from one worker to the next visible to the memory model (and to TSan).
+typedef struct ServerConnection
+{
+    pthread_mutex_t lock;
+    int fd;
+    size_t inUsed;
+    size_t outUsed;
+    struct ServerConnection *prev;
+    struct ServerConnection *next;
+    unsigned char in[SERVER_BUFFER_SIZE];
+    unsigned char out[SERVER_BUFFER_SIZE];
+} ServerConnection;
+
+// One worker thread of a server and the requests it has answered.
+typedef struct ServerWorker
+{
+    AttendanceStore *store;
+    long requests;
+} ServerWorker;
+
+static int setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+static int armServerEvent(AttendanceStore *store, int op, int fd, void *data, uint32_t events)
+{
+    struct epoll_event event;
+    event.events = events | EPOLLONESHOT;
+    event.data.ptr = data;
+    return epoll_ctl(store->server.epollFd, op, fd, &event);
+}
+
+static void closeServerConnection(AttendanceStore *store, ServerConnection *connection)
+{
+    pthread_mutex_lock(&store->server.connectionsLock);
+    if (connection->prev)
+    {
+        connection->prev->next = connection->next;
+    }
+    else
+    {
+        store->server.connections = connection->next;
+    }
+    if (connection->next)
+    {
+        connection->next->prev = connection->prev;
+    }
+    pthread_mutex_unlock(&store->server.connectionsLock);
+    close(connection->fd);
+    pthread_mutex_destroy(&connection->lock);
+    free(connection);
+}
+
+// Takes every pending connection off the (non-blocking) listening socket, then re-arms it.
+static void acceptServerClients(AttendanceStore *store)
+{
+    int fd;
+    while ((fd = accept(store->server.listenFd, NULL, NULL)) >= 0)
+    {
+        ServerConnection *connection = (ServerConnection *) malloc(sizeof(ServerConnection));
+        if (!connection || setNonBlocking(fd) != 0)
+        {
+            printf("Error: Could not set up a client connection.\n");
+            free(connection);
+            close(fd);
+            continue;
+        }
+        pthread_mutex_init(&connection->lock, NULL);
+        connection->fd = fd;
+        connection->inUsed = 0;
+        connection->outUsed = 0;
+        connection->prev = NULL;
+        pthread_mutex_lock(&store->server.connectionsLock);
+        connection->next = store->server.connections;
+        if (store->server.connections)
+        {
+            store->server.connections->prev = connection;
+        }
+        store->server.connections = connection;
+        pthread_mutex_unlock(&store->server.connectionsLock);
+        if (armServerEvent(store, EPOLL_CTL_ADD, fd, connection, EPOLLIN) != 0)
+        {
+            closeServerConnection(store, connection);
+        }
+    }
+    armServerEvent(store, EPOLL_CTL_MOD, store->server.listenFd, NULL, EPOLLIN);
+}
+
+// Sends as much pending output as the socket takes; returns -1 if the client is gone.
+static int flushServerConnection(ServerConnection *connection)
+{
+    size_t sent = 0;
+    while (sent < connection->outUsed)
+    {
+        ssize_t written = send(connection->fd, connection->out + sent, connection->outUsed - sent,
+                               MSG_NOSIGNAL);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                return -1;
+            }
+            break;
+        }
+        sent += (size_t) written;
+    }
+    memmove(connection->out, connection->out + sent, connection->outUsed - sent);
+    connection->outUsed -= sent;
+    return 0;
+}
+
+// Answers every complete request a client has sent, reading until the socket is drained or the
+// reply buffer is waiting on a slow reader. Returns -1 when the connection should be closed.
+static int serviceServerConnection(AttendanceStore *store, ServerConnection *connection,
+                                   long *requests)
+{
+    for (;;)
+    {
+        size_t offset = 0;
+        while (connection->inUsed - offset >= sizeof(uint16_t) &&
+               connection->outUsed + SERVER_MAX_REPLY <= SERVER_BUFFER_SIZE)
+        {
+            uint16_t length;
+            memcpy(&length, connection->in + offset, sizeof(length));
+            if (length == 0 || length > SERVER_MAX_REQUEST)
+            {
+                return -1;
+            }
+            if (connection->inUsed - offset < sizeof(length) + length)
+            {
+                break;
+            }
+            connection->outUsed +=
+                handleServerRequest(store, connection->in + offset + sizeof(length), length,
+                                    connection->out + connection->outUsed);
+            offset += sizeof(length) + length;
+            (*requests)++;
+        }
+        memmove(connection->in, connection->in + offset, connection->inUsed - offset);
+        connection->inUsed -= offset;
+
+        if (flushServerConnection(connection) != 0)
+        {
+            return -1;
+        }
+        if (connection->outUsed > 0)
+        {
+            return 0; // re-armed for EPOLLOUT; reading on would only grow the backlog
+        }
+        ssize_t received = recv(connection->fd, connection->in + connection->inUsed,
+                                SERVER_BUFFER_SIZE - connection->inUsed, 0);
+        if (received > 0)
+        {
+            connection->inUsed += (size_t) received;
+        }
+        else if (received == 0)
+        {
+            return -1;
+        }
+        else if (errno != EINTR)
+        {
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        }
+    }
+}
+
+// Every worker waits on the shared epoll set. One-shot registration hands each ready connection
+// to exactly one worker, so a busy client keeps one worker while the rest serve everyone else.
+static void *runServerWorker(void *arg)
+{
+    ServerWorker *worker = (ServerWorker *) arg;
+    AttendanceStore *store = worker->store;
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    while (!__atomic_load_n(&store->server.stopping, __ATOMIC_RELAXED))
+    {
+        int ready = epoll_wait(store->server.epollFd, events, SERVER_MAX_EVENTS, SERVER_POLL_MS);
+        for (int i = 0; i < ready; i++)
+        {
+            ServerConnection *connection = (ServerConnection *) events[i].data.ptr;
+            if (!connection)
+            {
+                acceptServerClients(store);
+            }
+            else
+            {
+                pthread_mutex_lock(&connection->lock);
+                int closing = serviceServerConnection(store, connection, &worker->requests) != 0 ||
+                              armServerEvent(store, EPOLL_CTL_MOD, connection->fd, connection,
+                                             connection->outUsed ? EPOLLIN | EPOLLOUT : EPOLLIN);
+                pthread_mutex_unlock(&connection->lock);
+                if (closing)
+                {
+                    closeServerConnection(store, connection);
+                }
+            }
+        }
+    }
+    return NULL;
+}
+#endif
+
+// Serves clients on the Unix socket at `path` with `threads` workers until stopServer is called.
+// Signal handling is left to the caller. Returns 0 on a clean shutdown.
+int runServer(AttendanceStore *store, const char *path, int threads)
+{
+#if HAVE_EPOLL
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        printf("Error: Socket path %s is too long.\n", path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+
+    if (mkdir(store->server.reportDir, 0700) != 0 && errno != EEXIST)
+    {
+        printf("Error: Could not create report directory %s\n", store->server.reportDir);
+        __atomic_store_n(&store->server.running, -1, __ATOMIC_RELEASE);
+        return -1;
+    }
+
+    // Only the owner may connect: the socket is restricted before it starts accepting clients.
+    store->server.listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    store->server.epollFd = epoll_create1(0);
+    unlink(path);
+    if (store->server.listenFd < 0 || store->server.epollFd < 0 ||
+        bind(store->server.listenFd, (struct sockaddr *) &address, sizeof(address)) != 0 ||
+        chmod(path, 0600) != 0 || listen(store->server.listenFd, SERVER_BACKLOG) != 0 ||
+        setNonBlocking(store->server.listenFd) != 0 ||
+        armServerEvent(store, EPOLL_CTL_ADD, store->server.listenFd, NULL, EPOLLIN) != 0)
+    {
+        printf("Error: Could not listen on %s\n", path);
+        __atomic_store_n(&store->server.running, -1, __ATOMIC_RELEASE);
+        if (store->server.listenFd >= 0)
+        {
+            close(store->server.listenFd);
+        }
+        if (store->server.epollFd >= 0)
+        {
+            close(store->server.epollFd);
+        }
+        return -1;
+    }
+
+    pthread_t handles[MAX_WORKER_THREADS];
+    ServerWorker workers[MAX_WORKER_THREADS];
+    int started[MAX_WORKER_THREADS] = {0};
+    printf("Serving %d students on %s with %d workers.\n", store->hashTable.count, path, threads);
+    fflush(stdout);
+    __atomic_store_n(&store->server.running, 1, __ATOMIC_RELEASE);
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t] = (ServerWorker) {store, 0};
+    }
+    for (int t = 1; t < threads; t++)
+    {
+        started[t] = pthread_create(&handles[t], NULL, runServerWorker, &workers[t]) == 0;
+    }
+    runServerWorker(&workers[0]);
+
+    long total = workers[0].requests;
+    for (int t = 1; t < threads; t++)
+    {
+        if (started[t])
+        {
+            pthread_join(handles[t], NULL);
+            total += workers[t].requests;
+        }
+    }
+    while (store->server.connections)
+    {
+        closeServerConnection(store, store->server.connections);
+    }
+    close(store->server.listenFd);
+    close(store->server.epollFd);
+    unlink(path);
+    __atomic_store_n(&store->server.stopping, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&store->server.running, 0, __ATOMIC_RELEASE);
+    printf("Server stopped after %ld requests.\n", total);
+    return 0;
+#else
+    (void) store;
+    (void) path;
+    (void) threads;
+    printf("Error: Server mode needs epoll and is only available on Linux.\n");
+    return -1;
+#endif
+}
+
+// Asks the store's running server to stop; runServer returns once its workers have noticed. It
+// only sets a flag, so a signal handler may call it.
+void stopServer(AttendanceStore *store)
+{
+    __atomic_store_n(&store->server.stopping, 1, __ATOMIC_RELAXED);
+}
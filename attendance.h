@@ -0,0 +1,424 @@
+// The attendance core: the student table, its indexes, journal, snapshots, reports and server
+// mode, all working on an AttendanceStore passed in by the caller. The menu program and the
+// benchmarks are both built on top of it.
+#ifndef ATTENDANCE_H
+#define ATTENDANCE_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#define HAVE_POSIX 0
+#else
+#define HAVE_POSIX 1
+#endif
+
+#ifdef __linux__
+#define HAVE_EPOLL 1
+#else
+#define HAVE_EPOLL 0
+#endif
+
+#define INITIAL_TABLE_SIZE 16
+#define MAX_LOAD_FACTOR 1
+#define REHASH_STEP 4
+#define ID_SUFFIX_SLOTS 10000
+#define TABLE_STRIPES 64 // lock stripes; a power of two so a stripe is the low bits of the hash
+#define SLAB_STUDENTS 1024
+#define NAME_INDEX_INITIAL 1024
+#define ID_INDEX_INITIAL 1024
+#define INDEX_TAIL_SCAN 4096 // longest unsorted index tail a removal scans instead of merging
+#define ATTENDANCE_THRESHOLD 75
+#define MAX_WORKER_THREADS 64
+#define LOADER_MIN_CHUNK_BYTES (1 << 20)
+#define IMPORT_MAX_WARNINGS 10
+#define SNAPSHOT_MAGIC "ATTSNAP"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+#define SNAPSHOT_WRITE_BATCH 4096
+#define REPORT_BUFFER_SIZE (1 << 18)
+#define REPORT_MAX_LINE 2048 // longest report line: a JSON row with fully escaped names
+#define REPORT_SHARD_STUDENTS 8192 // students formatted per worker per round of a parallel report
+#define DEFAULT_SNAPSHOT_FILE "attendance.snap"
+#define DEFAULT_JOURNAL_FILE "attendance.journal"
+#define JOURNAL_MAGIC "ATTJRNL"
+#define JOURNAL_VERSION 1
+#define JOURNAL_BUFFER_SIZE 65536
+#define JOURNAL_GROUP_COMMIT 512       // records per fsync
+#define JOURNAL_COMMIT_INTERVAL_MS 200 // longest a record waits for its group
+#define MAX_PATH_LEN 256
+#define DEFAULT_SOCKET_FILE "attendance.sock"
+#define DEFAULT_REPORT_DIR "reports" // where REPORT requests from server clients are written
+#define SERVER_BUFFER_SIZE 16384 // per-connection input and output buffers
+#define SERVER_MAX_REQUEST 512
+#define SERVER_MAX_REPLY 256
+#define SERVER_MAX_EVENTS 64
+#define SERVER_POLL_MS 200 // how often idle workers check for shutdown
+#define SERVER_BACKLOG 128
+#define GENERATOR_MAX_STUDENTS 10000000 // every ID in 590000000-599999999
+#define GENERATOR_COHORT_STUDENTS 500   // students per intake, each with its own 10,000 IDs
+#define GENERATOR_DEFAULT_SEED 4242
+#define MAX_NAME_LEN 50
+#define MAX_LINE_LEN 100
+#define MAX_SUBJECTS 10
+#define MAX_DAYS 31
+#define RESET "\033[0m"
+#define RED "\033[31m"
+#define GREEN "\033[32m"
+#define YELLOW "\033[33m"
+#define BLUE "\033[34m"
+#define MAGENTA "\033[35m"
+#define CYAN "\033[36m"
+#define BOLD "\033[1m"
+
+// Bit d of each mask describes day d + 1: `recorded` is set once attendance was taken that day
+// and `present` is set when the student was there.
+typedef struct AttendanceRecord
+{
+    uint32_t recorded;
+    uint32_t present;
+} AttendanceRecord;
+
+typedef struct AttendanceTotals
+{
+    long present;
+    long recorded;
+} AttendanceTotals;
+
+typedef struct Student
+{
+    int id;
+    char name[MAX_NAME_LEN];
+    AttendanceRecord subjects[MAX_SUBJECTS];
+    AttendanceTotals totals; // running counts over all subjects, kept in step by setAttendance
+    struct Student *next;
+    struct Student *suffixNext; // chain of students sharing the last four ID digits
+} Student;
+
+typedef struct MappedFile
+{
+    const char *data;
+    size_t size;
+    int mapped; // 1 when `data` is an mmap view, 0 when it was read into a heap buffer
+} MappedFile;
+
+// A snapshot is a SnapshotHeader followed by studentCount fixed-size SnapshotRecords in host byte
+// order, so loading copies records straight out of the mapped file without parsing them.
+typedef struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t recordSize;
+    uint32_t subjectCount;
+    uint64_t studentCount;
+    uint64_t checkpoint; // journals written after this snapshot carry the same number
+    char subjects[MAX_SUBJECTS][MAX_NAME_LEN];
+} SnapshotHeader;
+
+typedef struct SnapshotRecord
+{
+    int32_t id;
+    char name[MAX_NAME_LEN];
+    AttendanceRecord subjects[MAX_SUBJECTS];
+} SnapshotRecord;
+
+// Write-ahead log of every change since the last snapshot. Each record is an op byte, a payload
+// length byte, the payload and a checksum, so a torn final record is detected on replay. Records
+// are appended to one of two buffers under `lock`; the flusher thread writes the other buffer with
+// a single fsync per group under `writeLock`, when JOURNAL_GROUP_COMMIT records are pending or
+// every JOURNAL_COMMIT_INTERVAL_MS. A bulk load or import is synced once at its end instead. A
+// NULL `file` disables journaling.
+typedef struct Journal
+{
+    FILE *file;
+    char path[MAX_PATH_LEN];
+    char snapshotPath[MAX_PATH_LEN];
+    unsigned char buffers[2][JOURNAL_BUFFER_SIZE];
+    int active; // buffer taking appends
+    size_t used;
+    int pendingRecords;
+    int unsynced; // records were written during a bulk operation but not yet synced
+    int bulk;     // nesting depth of bulk operations in progress
+    long records;
+    long syncs;
+    pthread_mutex_t lock;      // active buffer and counters; never held across file writes
+    pthread_mutex_t writeLock; // file writes and fsync; taken before `lock`
+    pthread_cond_t wake;
+    pthread_t flusher;
+    int flusherRunning;
+    int stopFlusher;
+} Journal;
+
+// One word of a student's name: the entry's key is the name from `offset` on, compared without
+// regard to case, so "jain" finds "Anusha Nitin Jain" through its third word.
+typedef struct NameEntry
+{
+    Student *student; // NULL once the student is deleted, until the next compaction
+    int offset;       // once deleted: the distance to a later entry that may be live
+} NameEntry;
+
+// Entries [0, sortedCount) are sorted by key; later ones were appended since the last query and
+// are sorted and merged in lazily, so a bulk load pays for one sort instead of one per insert.
+typedef struct NameIndex
+{
+    NameEntry *entries;
+    long count;
+    long capacity;
+    long sortedCount;
+    long removed;
+} NameIndex;
+
+// Students in ID order. The ID is kept next to the pointer so deleted entries (student NULL)
+// still sort correctly until they are compacted away; like NameIndex, entries past sortedCount
+// were appended since the last ordered scan and are merged in lazily.
+typedef struct IdEntry
+{
+    int id;
+    Student *student;
+} IdEntry;
+
+typedef struct IdIndex
+{
+    IdEntry *entries;
+    long count;
+    long capacity;
+    long sortedCount;
+    long removed;
+} IdIndex;
+
+// The lock and attendance counters for the students whose IDs hash to one stripe. Concurrent
+// marks lock only the student's stripe, so writers to different stripes neither wait for each
+// other nor share a counter; inserts, deletes and new subjects lock every stripe. Keeping the
+// counters per stripe also keeps each stripe's hot data on its own cache lines.
+typedef struct TableStripe
+{
+    pthread_mutex_t lock;
+    AttendanceTotals subjectTotals[MAX_SUBJECTS];
+    long dayRecords[MAX_SUBJECTS][MAX_DAYS]; // students with a mark on each subject/day
+} TableStripe;
+
+typedef struct StudentSlab
+{
+    struct StudentSlab *nextSlab;
+    Student students[SLAB_STUDENTS];
+} StudentSlab;
+
+// Hands out Student records from large slabs. Deleted records go on a free list (linked through
+// `next`) for reuse, and releaseAllStudents drops every slab without visiting individual records.
+typedef struct StudentAllocator
+{
+    StudentSlab *slabs;
+    int slabCount;
+    int slabUsed; // records handed out from the newest slab
+    Student *freeList;
+    long freeCount;
+    long liveCount;
+    long totalAllocations;
+} StudentAllocator;
+
+typedef struct HashTable
+{
+    Student **buckets;
+    int size;
+    Student **oldBuckets; // table being drained by an incremental rehash, or NULL
+    int oldSize;
+    int rehashIndex;      // next bucket of oldBuckets to migrate
+    int count;
+} HashTable;
+
+typedef struct StudentCursor
+{
+    int inNewTable;
+    int bucket;
+    Student *node;
+} StudentCursor;
+
+// The listening socket and open clients of a store's server mode; see runServer.
+typedef struct Server
+{
+    int listenFd;
+    int epollFd;
+    pthread_mutex_t connectionsLock; // guards the list below, used to close clients on shutdown
+    struct ServerConnection *connections;
+    int stopping;
+    int running;
+    char reportDir[MAX_PATH_LEN]; // REPORT requests name a file in here; created by runServer
+} Server;
+
+// Everything one roster owns. Every core function takes the store it works on instead of
+// sharing globals, so a process can keep several independent stores side by side.
+typedef struct AttendanceStore
+{
+    HashTable hashTable;
+    StudentAllocator studentAllocator;
+    Student *suffixIndex[ID_SUFFIX_SLOTS];
+    NameIndex nameIndex;
+    IdIndex idIndex;
+    char subjectList[MAX_SUBJECTS][MAX_NAME_LEN];
+    int subjectCount;
+    int workerThreads; // 0 picks one thread per online CPU
+    int quiet;         // loads and reports skip their success messages, as when being timed
+    uint64_t checkpointId;
+    Journal journal;
+    TableStripe tableStripes[TABLE_STRIPES];
+    int stripeMask; // the concurrency benchmark sets 0 for a single global lock
+    Server server;
+} AttendanceStore;
+
+typedef enum ReportFormat
+{
+    REPORT_TEXT,
+    REPORT_CSV,
+    REPORT_JSON
+} ReportFormat;
+
+// A student together with the attendance figures a query ranked them by.
+typedef struct RankedStudent
+{
+    Student *student;
+    AttendanceTotals totals;
+} RankedStudent;
+
+typedef struct RosterStats
+{
+    int firstId;
+    int lastId;
+    int longestSuffixChain; // most students sharing one last-four-digit suffix
+    long sharedSuffixes;    // students whose suffix some other student also has
+    int shortestName;
+    int longestName;
+    double meanName;
+} RosterStats;
+
+// Server mode. Clients on a Unix domain socket send request frames: a 16-bit length in host byte
+// order (client and server share the machine) and then that many bytes, an opcode and its
+// payload. Every reply is a frame holding a ServerStatus byte and the opcode's result.
+//   PING    -                                       -> -
+//   SUBJECT name                                    -> u8 subject index (registered if new)
+//   MARK    i32 id, u8 subject, u8 day 1-31, i8 1/0 -> -   (-1 clears the mark)
+//   VIEW    i32 id                                  -> i32 id, u8 length, name, 10 x (u32
+//                                                      recorded mask, u32 present mask)
+//   REPORT  u8 format, u8 subject or 255, file name -> -   (written to Server.reportDir)
+typedef enum ServerOp
+{
+    SERVER_PING = 1,
+    SERVER_SUBJECT,
+    SERVER_MARK,
+    SERVER_VIEW,
+    SERVER_REPORT
+} ServerOp;
+
+typedef enum ServerStatus
+{
+    SERVER_OK,
+    SERVER_NOT_FOUND,
+    SERVER_BAD_REQUEST,
+    SERVER_FAILED
+} ServerStatus;
+
+#if defined(__GNUC__) || defined(__clang__)
+#define popcount32(x) __builtin_popcount(x)
+#else
+static inline int popcount32(uint32_t x)
+{
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    x = (x + (x >> 4)) & 0x0f0f0f0fu;
+    return (int) ((x * 0x01010101u) >> 24);
+}
+#endif
+
+extern const char *generatorSubjects[MAX_SUBJECTS];
+
+// A store with no students, subjects or journal; destroyStore closes its journal and frees it.
+AttendanceStore *createStore();
+void destroyStore(AttendanceStore *store);
+void freeHashTable(AttendanceStore *store);
+int resolveThreadCount(AttendanceStore *store);
+double nowSeconds();
+
+// Students and their attendance. These expect a single thread, or one that holds every stripe.
+Student *insertStudent(AttendanceStore *store, int id, const char *name);
+int removeStudent(AttendanceStore *store, int id);
+void deleteStudentById(AttendanceStore *store, int id);
+Student *findStudent(AttendanceStore *store, int id);
+Student *lookupStudent(AttendanceStore *store, int id, int *matches);
+Student *searchStudentById(AttendanceStore *store, int id);
+Student *firstStudent(AttendanceStore *store, StudentCursor *cursor);
+Student *nextStudent(AttendanceStore *store, StudentCursor *cursor);
+long findStudentsByName(AttendanceStore *store, const char *prefix, Student ***results);
+long findStudentsInRange(AttendanceStore *store, int low, int high, Student ***results);
+int parseIdRange(const char *first, const char *second, int *low, int *high);
+void prepareNameIndex(AttendanceStore *store);
+void prepareIdIndex(AttendanceStore *store);
+int isNameWordStart(const char *name, int offset);
+int suffixSlot(int id);
+double hashTableLoadFactor(AttendanceStore *store);
+int findSubjectIndex(AttendanceStore *store, const char *subject);
+int getSubjectIndex(AttendanceStore *store, const char *subject);
+int getAttendance(const Student *student, int subjectIndex, int day);
+void setAttendance(AttendanceStore *store, Student *student, int subjectIndex, int day, int status);
+void accountStudent(AttendanceStore *store, const Student *student, int delta);
+void beginRollCall(AttendanceStore *store, int subjectIndex, int day);
+void markStudent(AttendanceStore *store, Student *student, int subjectIndex, int day, int status);
+AttendanceTotals countAttendance(AttendanceStore *store, const Student *student);
+AttendanceTotals studentAttendance(const Student *student);
+AttendanceTotals subjectAttendance(AttendanceStore *store, int subjectIndex);
+AttendanceTotals classAttendance(AttendanceStore *store);
+int percentageOf(AttendanceTotals totals);
+int isBelowThreshold(AttendanceTotals totals, int threshold);
+int total_percentage(Student *student);
+
+// Thread-safe entry points.
+void lockAllStripes(AttendanceStore *store);
+void unlockAllStripes(AttendanceStore *store);
+int concurrentMark(AttendanceStore *store, int id, int subjectIndex, int day, int status);
+int concurrentView(AttendanceStore *store, int id, Student *copy);
+int concurrentInsert(AttendanceStore *store, int id, const char *name);
+int concurrentDelete(AttendanceStore *store, int id);
+int concurrentSubjectIndex(AttendanceStore *store, const char *subject);
+
+// Files, snapshots and the journal.
+int mapFile(const char *filename, MappedFile *file);
+void unmapFile(MappedFile *file);
+void loadStudentsFromFile(AttendanceStore *store, const char *filename);
+void importAttendance(AttendanceStore *store, const char *filename);
+int saveSnapshot(AttendanceStore *store, const char *filename);
+int loadSnapshot(AttendanceStore *store, const char *filename);
+int recoverState(AttendanceStore *store, const char *snapshotPath, const char *journalPath);
+int checkpointState(AttendanceStore *store);
+void closeJournal(AttendanceStore *store);
+int journalCommit(AttendanceStore *store);
+void journalInsert(AttendanceStore *store, int id, const char *name);
+
+// Reports and rankings.
+int parseReportFormat(const char *name);
+int parseSubjectSelection(AttendanceStore *store, char *list, int *subjects);
+int generateReports(AttendanceStore *store, const int *subjects, int count, const char *target,
+                    int combined, ReportFormat format);
+void generateReport(AttendanceStore *store, const char *filename, const char *subject);
+AttendanceTotals rankingTotals(const Student *student, int subjectIndex);
+int compareHighestFirst(const void *a, const void *b);
+long rankStudents(AttendanceStore *store, long k, int subjectIndex, int highest,
+                  RankedStudent *results);
+int reportStudentsBelow(AttendanceStore *store, int threshold, const char *subject,
+                        const char *filename, ReportFormat format, int useColor);
+int reportRanking(AttendanceStore *store, long k, int highest, const char *subject,
+                  const char *filename, ReportFormat format, int useColor);
+
+// Synthetic rosters and marks.
+uint32_t generatorRandom(uint32_t *state);
+int generatedAttendanceRate(int id);
+int *generateRosterIds(int count, uint32_t seed);
+int writeGeneratedRoster(const char *filename, int count, uint32_t seed, RosterStats *stats);
+int writeGeneratedMarks(const char *filename, int students, long marks, int subjects,
+                        uint32_t seed);
+
+// Server mode. The library installs no signal handlers; a program that wants SIGINT to stop the
+// server calls stopServer from its own handler.
+int runServer(AttendanceStore *store, const char *path, int threads);
+void stopServer(AttendanceStore *store);
+
+#endif
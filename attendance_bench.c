@@ -0,0 +1,1502 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "attendance.h"
+
+#define LOADGEN_DEFAULT_CLIENTS 8
+#define LOADGEN_DEFAULT_REQUESTS 200000
+#define LOADGEN_DEFAULT_SUBJECT "LOADGEN"
+#define BENCH_DEFAULT_STUDENTS 100000
+#define BENCH_DEFAULT_ROSTER_LINES 2000000
+#define BENCH_ROSTER_FILE "attendance_bench_roster.tmp"
+#define BENCH_SNAPSHOT_FILE "attendance_bench_snapshot.tmp"
+#define BENCH_JOURNAL_FILE "attendance_bench_journal.tmp"
+#define BENCH_DEFAULT_JOURNAL_MARKS 200000
+#define BENCH_DEFAULT_CONCURRENT_MARKS 4000000
+#define BENCH_MAX_CONCURRENT_THREADS 16
+#define BENCH_DEFAULT_IMPORT_MARKS 1000000
+#define BENCH_DEFAULT_RANK_STUDENTS 200000
+#define BENCH_RANK_K 50
+#define BENCH_NAME_QUERIES 1000
+#define BENCH_RANGE_QUERIES 1000
+#define BENCH_RANGE_WIDTH 100
+#define BENCH_SOCKET_FILE "attendance_bench.sock"
+#define BENCH_IMPORT_FILE "attendance_bench_marks.tmp"
+#define BENCH_REPORT_FILE "attendance_bench_report.tmp"
+#define BENCH_LEGACY_REPORT_FILE "attendance_bench_report_legacy.tmp"
+#define BENCH_PARALLEL_REPORT_FILE "attendance_bench_report_parallel.tmp"
+#define BENCH_REPETITIONS 5
+#define BENCH_MICRO_BATCH 1000 // operations per timed sample of the fast microbenchmarks
+#define BENCH_MICRO_WARMUP 10
+#define BENCH_MICRO_SAMPLES 100
+#define BENCH_MICRO_SLOW_SAMPLES 10 // loads and reports, timed one call at a time
+
+// Fills the table with `count` students with attendance recorded on random days of every subject.
+void populateBenchStudents(AttendanceStore *store, int count)
+{
+    uint32_t seed = 12345;
+    char name[MAX_NAME_LEN];
+    for (int i = store->subjectCount; i < MAX_SUBJECTS; i++)
+    {
+        snprintf(name, sizeof(name), "SUBJECT%d", i + 1);
+        getSubjectIndex(store, name);
+    }
+    for (int i = 0; i < count; i++)
+    {
+        snprintf(name, sizeof(name), "Student %d", i);
+        Student *student = insertStudent(store, 590000000 + i, name);
+        for (int subject = 0; subject < MAX_SUBJECTS; subject++)
+        {
+            for (int day = 0; day < MAX_DAYS; day++)
+            {
+                uint32_t r = generatorRandom(&seed) % 10;
+                if (r < 8)
+                {
+                    setAttendance(store, student, subject, day, r < 6 ? 1 : 0);
+                }
+            }
+        }
+    }
+}
+
+// The per-day loop total_percentage used before popcount, kept as the benchmark baseline.
+int nestedLoopPercentage(AttendanceStore *store, Student *student)
+{
+    AttendanceTotals totals = {0, 0};
+    for (int i = 0; i < store->subjectCount; i++)
+    {
+        for (int day = 0; day < MAX_DAYS; day++)
+        {
+            int status = getAttendance(student, i, day);
+            if (status != -1)
+            {
+                totals.recorded++;
+                if (status == 1)
+                {
+                    totals.present++;
+                }
+            }
+        }
+    }
+    return percentageOf(totals);
+}
+
+int popcountPercentage(AttendanceStore *store, Student *student)
+{
+    return percentageOf(countAttendance(store, student));
+}
+
+int counterPercentage(AttendanceStore *store, Student *student)
+{
+    (void) store;
+    return total_percentage(student);
+}
+
+double timePercentagePass(AttendanceStore *store, int (*percentage)(AttendanceStore *, Student *),
+                          long *checksum)
+{
+    double best = 0;
+    for (int rep = 0; rep < BENCH_REPETITIONS; rep++)
+    {
+        double start = nowSeconds();
+        long sum = 0;
+        StudentCursor cursor;
+        for (Student *current = firstStudent(store, &cursor); current != NULL;
+             current = nextStudent(store, &cursor))
+        {
+            sum += percentage(store, current);
+        }
+        double elapsed = nowSeconds() - start;
+        if (rep == 0 || elapsed < best)
+        {
+            best = elapsed;
+        }
+        *checksum = sum;
+    }
+    return best;
+}
+
+void benchPercentage(AttendanceStore *store, int count)
+{
+    populateBenchStudents(store, count);
+    printf("total_percentage over %d students, %d subjects x %d days (best of %d)\n", count,
+           store->subjectCount, MAX_DAYS, BENCH_REPETITIONS);
+
+    long loopSum, popcountSum, counterSum;
+    double loopTime = timePercentagePass(store, nestedLoopPercentage, &loopSum);
+    double popcountTime = timePercentagePass(store, popcountPercentage, &popcountSum);
+    double counterTime = timePercentagePass(store, counterPercentage, &counterSum);
+    printf("  nested loop : %9.3f ms  %8.1f ns/student\n", loopTime * 1e3, loopTime * 1e9 / count);
+    printf("  popcount    : %9.3f ms  %8.1f ns/student  %6.1fx\n", popcountTime * 1e3,
+           popcountTime * 1e9 / count, loopTime / popcountTime);
+    printf("  counters    : %9.3f ms  %8.1f ns/student  %6.1fx\n", counterTime * 1e3,
+           counterTime * 1e9 / count, loopTime / counterTime);
+    printf("  checksums   : %s\n",
+           loopSum == popcountSum && loopSum == counterSum ? "match" : "DIFFER");
+
+    int below = 0;
+    double start = nowSeconds();
+    StudentCursor cursor;
+    for (Student *current = firstStudent(store, &cursor); current != NULL;
+         current = nextStudent(store, &cursor))
+    {
+        below += isBelowThreshold(studentAttendance(current), ATTENDANCE_THRESHOLD);
+    }
+    double belowTime = nowSeconds() - start;
+    printf("  below %d%%   : %9d students in %7.3f ms\n", ATTENDANCE_THRESHOLD, below,
+           belowTime * 1e3);
+    printf("  subject %-12s %3d%%, whole class %3d%%\n", store->subjectList[0],
+           percentageOf(subjectAttendance(store, 0)), percentageOf(classAttendance(store)));
+}
+
+// The fgets/sscanf loader used before the mmap parser, kept as the benchmark baseline.
+long loadStudentsLegacy(AttendanceStore *store, const char *filename)
+{
+    FILE *file = fopen(filename, "r");
+    if (!file)
+    {
+        return 0;
+    }
+    long loaded = 0;
+    char line[MAX_LINE_LEN];
+    while (fgets(line, sizeof(line), file))
+    {
+        int id;
+        char name[MAX_NAME_LEN];
+        if (sscanf(line, "%d,%49[^\n]", &id, name) == 2)
+        {
+            insertStudent(store, id, name);
+            loaded++;
+        }
+    }
+    fclose(file);
+    return loaded;
+}
+
+// Sums a hash of every student's ID, name and attendance, so equal contents compare equal
+// regardless of chain order.
+uint32_t tableChecksum(AttendanceStore *store)
+{
+    uint32_t sum = 0;
+    StudentCursor cursor;
+    for (Student *current = firstStudent(store, &cursor); current != NULL;
+         current = nextStudent(store, &cursor))
+    {
+        uint32_t hash = (2166136261u ^ (uint32_t) current->id) * 16777619u;
+        for (const char *c = current->name; *c; c++)
+        {
+            hash = (hash ^ (unsigned char) *c) * 16777619u;
+        }
+        for (int i = 0; i < MAX_SUBJECTS; i++)
+        {
+            hash = (hash ^ current->subjects[i].recorded) * 16777619u;
+            hash = (hash ^ current->subjects[i].present) * 16777619u;
+        }
+        sum += hash;
+    }
+    return sum;
+}
+
+void benchSnapshot(AttendanceStore *store, int count)
+{
+    populateBenchStudents(store, count);
+    uint32_t before = tableChecksum(store);
+
+    double start = nowSeconds();
+    int saved = saveSnapshot(store, BENCH_SNAPSHOT_FILE);
+    double saveTime = nowSeconds() - start;
+    freeHashTable(store);
+
+    start = nowSeconds();
+    int loaded = saved == 0 ? loadSnapshot(store, BENCH_SNAPSHOT_FILE) : -1;
+    double loadTime = nowSeconds() - start;
+    remove(BENCH_SNAPSHOT_FILE);
+    if (loaded != 0)
+    {
+        return;
+    }
+
+    double megabytes =
+        (sizeof(SnapshotHeader) + (double) count * sizeof(SnapshotRecord)) / (1024.0 * 1024.0);
+    printf("Snapshot of %d students (%.1f MB)\n", count, megabytes);
+    printf("  save : %8.1f ms  %7.1f MB/s\n", saveTime * 1e3, megabytes / saveTime);
+    printf("  load : %8.1f ms  %7.1f MB/s\n", loadTime * 1e3, megabytes / loadTime);
+    printf("  state after reload : %s\n", tableChecksum(store) == before ? "identical" : "DIFFER");
+}
+
+void benchJournal(AttendanceStore *store, int marks)
+{
+    populateBenchStudents(store, BENCH_DEFAULT_STUDENTS / 10);
+    remove(BENCH_SNAPSHOT_FILE);
+    remove(BENCH_JOURNAL_FILE);
+    if (recoverState(store, BENCH_SNAPSHOT_FILE, BENCH_JOURNAL_FILE) != 0 ||
+        checkpointState(store) != 0)
+    {
+        return;
+    }
+
+    uint32_t seed = 777;
+    int count = store->hashTable.count;
+    double start = nowSeconds();
+    long syncsBefore = __atomic_load_n(&store->journal.syncs, __ATOMIC_RELAXED);
+    for (int i = 0; i < marks; i++)
+    {
+        Student *student = findStudent(store, 590000000 + (int) (generatorRandom(&seed) % count));
+        markStudent(store, student, (int) (generatorRandom(&seed) % MAX_SUBJECTS),
+                    (int) (generatorRandom(&seed) % MAX_DAYS), (int) (generatorRandom(&seed) % 2));
+    }
+    journalCommit(store);
+    double groupTime = nowSeconds() - start;
+    long groupSyncs = __atomic_load_n(&store->journal.syncs, __ATOMIC_RELAXED) - syncsBefore;
+
+    int singleMarks = marks < 2000 ? marks : 2000;
+    start = nowSeconds();
+    syncsBefore = __atomic_load_n(&store->journal.syncs, __ATOMIC_RELAXED);
+    for (int i = 0; i < singleMarks; i++)
+    {
+        Student *student = findStudent(store, 590000000 + (int) (generatorRandom(&seed) % count));
+        markStudent(store, student, 0, (int) (generatorRandom(&seed) % MAX_DAYS), 1);
+        journalCommit(store);
+    }
+    double singleTime = nowSeconds() - start;
+    long singleSyncs = __atomic_load_n(&store->journal.syncs, __ATOMIC_RELAXED) - syncsBefore;
+
+    uint32_t before = tableChecksum(store);
+    closeJournal(store);
+    freeHashTable(store);
+    start = nowSeconds();
+    int recovered = recoverState(store, BENCH_SNAPSHOT_FILE, BENCH_JOURNAL_FILE);
+    double replayTime = nowSeconds() - start;
+    uint32_t after = tableChecksum(store);
+    closeJournal(store);
+    remove(BENCH_SNAPSHOT_FILE);
+    remove(BENCH_JOURNAL_FILE);
+
+    printf("Journal of attendance marks over %d students\n", count);
+    printf("  group commit    : %8d marks %8.1f ms  %10.0f marks/s  %6ld fsyncs\n", marks,
+           groupTime * 1e3, marks / groupTime, groupSyncs);
+    printf("  fsync per mark  : %8d marks %8.1f ms  %10.0f marks/s  %6ld fsyncs\n", singleMarks,
+           singleTime * 1e3, singleMarks / singleTime, singleSyncs);
+    printf("  snapshot+replay : %8.1f ms, state %s\n", replayTime * 1e3,
+           recovered == 0 && before == after ? "identical" : "DIFFER");
+}
+
+// The fprintf report writer generateReport used before ReportWriter, kept as the benchmark
+// baseline (listing students in ID order, as reports now do).
+void legacyReport(AttendanceStore *store, const char *filename, int subjectIndex)
+{
+    FILE *file = fopen(filename, "w");
+    if (!file)
+    {
+        printf("Error: Could not open file %s for writing\n", filename);
+        return;
+    }
+
+    uint32_t recordedDays = 0;
+    StudentCursor cursor;
+    for (Student *current = firstStudent(store, &cursor); current != NULL;
+         current = nextStudent(store, &cursor))
+    {
+        recordedDays |= current->subjects[subjectIndex].recorded;
+    }
+    int minDay = MAX_DAYS + 1, maxDay = 0;
+    for (int day = 0; day < MAX_DAYS; day++)
+    {
+        if (recordedDays & (1u << day))
+        {
+            if (day + 1 < minDay)
+                minDay = day + 1;
+            if (day + 1 > maxDay)
+                maxDay = day + 1;
+        }
+    }
+
+    fprintf(file, "%s Attendance Report\n", store->subjectList[subjectIndex]);
+    fprintf(file, "%-10s %-30s", "ID", "Name");
+    for (int day = minDay; day <= maxDay; day++)
+    {
+        fprintf(file, " Day%-2d", day);
+    }
+    fprintf(file, "\n");
+    fprintf(
+        file,
+        "--------------------------------------------------------------------------------------\n");
+    prepareIdIndex(store);
+    for (long entry = 0; entry < store->idIndex.sortedCount; entry++)
+    {
+        Student *current = store->idIndex.entries[entry].student;
+        if (!current)
+        {
+            continue;
+        }
+        fprintf(file, "%-10d %-30s", current->id, current->name);
+        for (int day = minDay; day <= maxDay; day++)
+        {
+            if (getAttendance(current, subjectIndex, day - 1) == 1)
+            {
+                fprintf(file, " P  ");
+            }
+            else
+            {
+                fprintf(file, " A  ");
+            }
+        }
+        fprintf(file, "\n");
+    }
+    fclose(file);
+}
+
+int sameFileContents(const char *first, const char *second)
+{
+    MappedFile a, b;
+    if (mapFile(first, &a) != 0)
+    {
+        return 0;
+    }
+    if (mapFile(second, &b) != 0)
+    {
+        unmapFile(&a);
+        return 0;
+    }
+    int same = a.size == b.size && memcmp(a.data, b.data, a.size) == 0;
+    unmapFile(&a);
+    unmapFile(&b);
+    return same;
+}
+
+void benchReport(AttendanceStore *store, int count)
+{
+    populateBenchStudents(store, count);
+    int subject = 0;
+    double legacyTime = 1e30, writerTime = 1e30;
+    for (int rep = 0; rep < BENCH_REPETITIONS; rep++)
+    {
+        double start = nowSeconds();
+        legacyReport(store, BENCH_LEGACY_REPORT_FILE, subject);
+        double elapsed = nowSeconds() - start;
+        legacyTime = elapsed < legacyTime ? elapsed : legacyTime;
+
+        start = nowSeconds();
+        int failed = generateReports(store, &subject, 1, BENCH_REPORT_FILE, 1, REPORT_TEXT);
+        elapsed = nowSeconds() - start;
+        writerTime = elapsed < writerTime ? elapsed : writerTime;
+        if (failed)
+        {
+            return;
+        }
+    }
+
+    struct stat info;
+    double megabytes = stat(BENCH_REPORT_FILE, &info) == 0 ? info.st_size / (1024.0 * 1024.0) : 0;
+    int same = sameFileContents(BENCH_LEGACY_REPORT_FILE, BENCH_REPORT_FILE);
+    remove(BENCH_LEGACY_REPORT_FILE);
+    printf("%s report for %d students, %d days (%.1f MB, best of %d)\n",
+           store->subjectList[subject], count, MAX_DAYS, megabytes, BENCH_REPETITIONS);
+    printf("  fprintf      : %8.1f ms  %7.1f MB/s\n", legacyTime * 1e3, megabytes / legacyTime);
+    printf("  ReportWriter : %8.1f ms  %7.1f MB/s  %5.1fx\n", writerTime * 1e3,
+           megabytes / writerTime, legacyTime / writerTime);
+    printf("  output : %s\n", same ? "identical" : "DIFFER");
+
+    // Every subject through the sharded writer, against the serial writer's output.
+    int subjects[MAX_SUBJECTS];
+    for (int i = 0; i < store->subjectCount; i++)
+    {
+        subjects[i] = i;
+    }
+    int savedThreads = store->workerThreads;
+    double serialTime = 0;
+    printf("All %d subjects in one pass:\n", store->subjectCount);
+    for (int threads = 1; threads <= 8; threads *= 2)
+    {
+        const char *file = threads == 1 ? BENCH_REPORT_FILE : BENCH_PARALLEL_REPORT_FILE;
+        double best = 1e30;
+        store->workerThreads = threads;
+        for (int rep = 0; rep < BENCH_REPETITIONS; rep++)
+        {
+            double start = nowSeconds();
+            generateReports(store, subjects, store->subjectCount, file, 1, REPORT_TEXT);
+            double elapsed = nowSeconds() - start;
+            best = elapsed < best ? elapsed : best;
+        }
+        serialTime = threads == 1 ? best : serialTime;
+        megabytes = stat(file, &info) == 0 ? info.st_size / (1024.0 * 1024.0) : 0;
+        printf("  %d thread%s : %8.1f ms  %7.1f MB/s  %5.2fx  %s\n", threads,
+               threads == 1 ? " " : "s", best * 1e3, megabytes / best, serialTime / best,
+               threads == 1 || sameFileContents(BENCH_REPORT_FILE, file) ? "identical" : "DIFFER");
+    }
+    store->workerThreads = savedThreads;
+    remove(BENCH_PARALLEL_REPORT_FILE);
+    remove(BENCH_REPORT_FILE);
+}
+
+const char *benchFirstNames[] = {"Aarav", "ANUSHA", "Tanmay", "Ruhani", "Pranav", "Diya",
+                                 "Ishaan", "MEERA", "Kabir", "Saanvi", "Arjun", "Zoya"};
+const char *benchLastNames[] = {"Sharma", "JAIN", "Singal", "Kshirsagar", "Gupta", "Iyer",
+                                "Reddy", "Khan", "Das", "Patel", "Menon", "Bose", "Verma"};
+
+// Name search over a roster of mixed-case generated names, checked against a linear scan.
+void benchNames(AttendanceStore *store, int count)
+{
+    uint32_t seed = 4242;
+    char name[MAX_NAME_LEN];
+    int firstCount = sizeof(benchFirstNames) / sizeof(benchFirstNames[0]);
+    int lastCount = sizeof(benchLastNames) / sizeof(benchLastNames[0]);
+    for (int i = 0; i < count; i++)
+    {
+        snprintf(name, sizeof(name), "%s %c%c%c %s",
+                 benchFirstNames[generatorRandom(&seed) % firstCount],
+                 'A' + generatorRandom(&seed) % 26, 'a' + generatorRandom(&seed) % 26,
+                 'a' + generatorRandom(&seed) % 26,
+                 benchLastNames[generatorRandom(&seed) % lastCount]);
+        insertStudent(store, 590000000 + i, name);
+    }
+    double start = nowSeconds();
+    prepareNameIndex(store);
+    double sortTime = nowSeconds() - start;
+
+    char prefixes[BENCH_NAME_QUERIES][8];
+    for (int q = 0; q < BENCH_NAME_QUERIES; q++)
+    {
+        snprintf(prefixes[q], sizeof(prefixes[q]), "%c%c%c", 'a' + generatorRandom(&seed) % 26,
+                 'a' + generatorRandom(&seed) % 26, 'a' + generatorRandom(&seed) % 26);
+        if (q % 4 == 0)
+        {
+            snprintf(prefixes[q], sizeof(prefixes[q]), "%.4s",
+                     benchLastNames[generatorRandom(&seed) % lastCount]);
+        }
+    }
+    long indexMatches = 0;
+    start = nowSeconds();
+    for (int q = 0; q < BENCH_NAME_QUERIES; q++)
+    {
+        Student **matches;
+        indexMatches += findStudentsByName(store, prefixes[q], &matches);
+        free(matches);
+    }
+    double indexTime = nowSeconds() - start;
+
+    long scanMatches = 0;
+    start = nowSeconds();
+    for (int q = 0; q < BENCH_NAME_QUERIES; q++)
+    {
+        size_t length = strlen(prefixes[q]);
+        StudentCursor cursor;
+        for (Student *current = firstStudent(store, &cursor); current;
+             current = nextStudent(store, &cursor))
+        {
+            for (int offset = 0; current->name[offset]; offset++)
+            {
+                int matched = isNameWordStart(current->name, offset);
+                for (size_t i = 0; matched && i < length; i++)
+                {
+                    matched = tolower((unsigned char) current->name[offset + i]) ==
+                              tolower((unsigned char) prefixes[q][i]);
+                }
+                if (matched)
+                {
+                    scanMatches++;
+                    break;
+                }
+            }
+        }
+    }
+    double scanTime = nowSeconds() - start;
+
+    printf("Name search over %d students, %ld indexed words, %d prefix queries\n", count,
+           store->nameIndex.count, BENCH_NAME_QUERIES);
+    printf("  index sort  : %8.1f ms (once, on the first query after loading)\n",
+           sortTime * 1e3);
+    printf("  linear scan : %8.1f us/query\n", scanTime * 1e6 / BENCH_NAME_QUERIES);
+    printf("  name index  : %8.1f us/query  %6.1fx\n", indexTime * 1e6 / BENCH_NAME_QUERIES,
+           scanTime / indexTime);
+    printf("  matches : %s (%ld)\n", indexMatches == scanMatches ? "identical" : "DIFFER",
+           indexMatches);
+}
+
+// ID range queries through the ordered index against filtering a full table scan.
+void benchRange(AttendanceStore *store, int count)
+{
+    populateBenchStudents(store, count);
+    double start = nowSeconds();
+    prepareIdIndex(store);
+    double sortTime = nowSeconds() - start;
+
+    uint32_t seed = 31337;
+    int lows[BENCH_RANGE_QUERIES];
+    for (int q = 0; q < BENCH_RANGE_QUERIES; q++)
+    {
+        lows[q] = 590000000 + (int) (generatorRandom(&seed) % count);
+    }
+    long indexMatches = 0, scanMatches = 0;
+    start = nowSeconds();
+    for (int q = 0; q < BENCH_RANGE_QUERIES; q++)
+    {
+        Student **matches;
+        indexMatches += findStudentsInRange(store, lows[q], lows[q] + BENCH_RANGE_WIDTH - 1,
+                                            &matches);
+        free(matches);
+    }
+    double indexTime = nowSeconds() - start;
+
+    start = nowSeconds();
+    for (int q = 0; q < BENCH_RANGE_QUERIES; q++)
+    {
+        StudentCursor cursor;
+        for (Student *current = firstStudent(store, &cursor); current;
+             current = nextStudent(store, &cursor))
+        {
+            scanMatches += current->id >= lows[q] && current->id < lows[q] + BENCH_RANGE_WIDTH;
+        }
+    }
+    double scanTime = nowSeconds() - start;
+
+    printf("ID range queries over %d students (%d queries of %d IDs)\n", count,
+           BENCH_RANGE_QUERIES, BENCH_RANGE_WIDTH);
+    printf("  index order : %8.1f ms (once, on the first ordered scan after loading)\n",
+           sortTime * 1e3);
+    printf("  table scan  : %8.1f us/query\n", scanTime * 1e6 / BENCH_RANGE_QUERIES);
+    printf("  ID index    : %8.1f us/query  %6.1fx\n", indexTime * 1e6 / BENCH_RANGE_QUERIES,
+           scanTime / indexTime);
+    printf("  matches : %s (%ld)\n", indexMatches == scanMatches ? "identical" : "DIFFER",
+           indexMatches);
+}
+
+typedef struct MarkWorker
+{
+    AttendanceStore *store;
+    uint32_t seed;
+    int students;
+    long marks;
+    long missed;
+} MarkWorker;
+
+void *runMarkWorker(void *arg)
+{
+    MarkWorker *worker = (MarkWorker *) arg;
+    AttendanceStore *store = worker->store;
+    for (long i = 0; i < worker->marks; i++)
+    {
+        uint32_t r = generatorRandom(&worker->seed);
+        int id = 590000000 + (int) (r % (uint32_t) worker->students);
+        r = generatorRandom(&worker->seed);
+        worker->missed += concurrentMark(store, id, (int) (r % MAX_SUBJECTS),
+                                         (int) ((r >> 8) % MAX_DAYS), (int) ((r >> 16) & 1)) != 0;
+    }
+    return NULL;
+}
+
+// Marks from 1 to 16 threads at once, first with the 64 stripe locks and then with every
+// student mapped to one stripe (a single global lock), then checks that the per-student and
+// per-stripe counters still agree with the bitmaps.
+void benchConcurrent(AttendanceStore *store, long marks)
+{
+    populateBenchStudents(store, BENCH_DEFAULT_STUDENTS);
+    printf("%ld concurrent marks over %d students\n", marks, store->hashTable.count);
+    printf("  %-8s %16s %16s\n", "threads", "striped", "one lock");
+    double baseline = 0;
+    long missed = 0;
+    for (int threads = 1; threads <= BENCH_MAX_CONCURRENT_THREADS; threads *= 2)
+    {
+        double rates[2];
+        for (int mode = 0; mode < 2; mode++)
+        {
+            MarkWorker workers[BENCH_MAX_CONCURRENT_THREADS];
+            pthread_t handles[BENCH_MAX_CONCURRENT_THREADS];
+            int started[BENCH_MAX_CONCURRENT_THREADS] = {0};
+            store->stripeMask = mode == 0 ? TABLE_STRIPES - 1 : 0;
+            double start = nowSeconds();
+            for (int t = 0; t < threads; t++)
+            {
+                workers[t] = (MarkWorker) {store, (uint32_t) (t + 1) * 2654435761u,
+                                           store->hashTable.count, marks / threads, 0};
+                started[t] = pthread_create(&handles[t], NULL, runMarkWorker, &workers[t]) == 0;
+            }
+            for (int t = 0; t < threads; t++)
+            {
+                if (started[t])
+                {
+                    pthread_join(handles[t], NULL);
+                }
+                else
+                {
+                    runMarkWorker(&workers[t]);
+                }
+                missed += workers[t].missed;
+            }
+            rates[mode] = (marks / threads) * threads / (nowSeconds() - start);
+        }
+        baseline = threads == 1 ? rates[0] : baseline;
+        printf("  %-8d %9.0f/s %4.1fx %9.0f/s\n", threads, rates[0], rates[0] / baseline,
+               rates[1]);
+    }
+    store->stripeMask = TABLE_STRIPES - 1;
+
+    int consistent = missed == 0;
+    AttendanceTotals class = classAttendance(store), counted = {0, 0};
+    StudentCursor cursor;
+    for (Student *current = firstStudent(store, &cursor); current;
+         current = nextStudent(store, &cursor))
+    {
+        AttendanceTotals totals = countAttendance(store, current);
+        consistent &= totals.present == current->totals.present &&
+                      totals.recorded == current->totals.recorded;
+        counted.present += totals.present;
+        counted.recorded += totals.recorded;
+    }
+    consistent &= counted.present == class.present && counted.recorded == class.recorded;
+    printf("  counters : %s\n", consistent ? "consistent" : "INCONSISTENT");
+}
+
+void benchRank(AttendanceStore *store, int count)
+{
+    populateBenchStudents(store, count);
+    RankedStudent top[BENCH_RANK_K];
+    RankedStudent *all = (RankedStudent *) malloc(count * sizeof(RankedStudent));
+    if (!all)
+    {
+        printf("Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    double heapTime = 1e30, sortTime = 1e30;
+    long found = 0, sorted = 0;
+    for (int rep = 0; rep < BENCH_REPETITIONS; rep++)
+    {
+        double start = nowSeconds();
+        found = rankStudents(store, BENCH_RANK_K, -1, 1, top);
+        double elapsed = nowSeconds() - start;
+        heapTime = elapsed < heapTime ? elapsed : heapTime;
+
+        start = nowSeconds();
+        sorted = 0;
+        StudentCursor cursor;
+        for (Student *current = firstStudent(store, &cursor); current;
+             current = nextStudent(store, &cursor))
+        {
+            RankedStudent entry = {current, rankingTotals(current, -1)};
+            if (entry.totals.recorded > 0)
+            {
+                all[sorted++] = entry;
+            }
+        }
+        qsort(all, sorted, sizeof(RankedStudent), compareHighestFirst);
+        elapsed = nowSeconds() - start;
+        sortTime = elapsed < sortTime ? elapsed : sortTime;
+    }
+
+    int same = found == (sorted < BENCH_RANK_K ? sorted : BENCH_RANK_K);
+    for (long i = 0; same && i < found; i++)
+    {
+        same = top[i].student == all[i].student;
+    }
+    free(all);
+    printf("Top %d of %d students by attendance (best of %d)\n", BENCH_RANK_K, count,
+           BENCH_REPETITIONS);
+    printf("  full sort     : %8.2f ms\n", sortTime * 1e3);
+    printf("  bounded heap  : %8.2f ms  %5.1fx\n", heapTime * 1e3, sortTime / heapTime);
+    printf("  ranking : %s\n", same ? "identical" : "DIFFER");
+}
+
+void benchImport(AttendanceStore *store, int marks)
+{
+    if (writeGeneratedRoster(BENCH_ROSTER_FILE, BENCH_DEFAULT_STUDENTS, GENERATOR_DEFAULT_SEED,
+                             NULL) != 0 ||
+        writeGeneratedMarks(BENCH_IMPORT_FILE, BENCH_DEFAULT_STUDENTS, marks, MAX_SUBJECTS,
+                            GENERATOR_DEFAULT_SEED) != 0)
+    {
+        return;
+    }
+    loadStudentsFromFile(store, BENCH_ROSTER_FILE);
+    remove(BENCH_ROSTER_FILE);
+
+    printf("Importing %d marks for %d students\n", marks, store->hashTable.count);
+    importAttendance(store, BENCH_IMPORT_FILE);
+    remove(BENCH_IMPORT_FILE);
+}
+
+void benchLoad(AttendanceStore *store, int lines)
+{
+    if (writeGeneratedRoster(BENCH_ROSTER_FILE, lines, GENERATOR_DEFAULT_SEED, NULL) != 0)
+    {
+        return;
+    }
+    MappedFile file;
+    mapFile(BENCH_ROSTER_FILE, &file);
+    double megabytes = file.size / (1024.0 * 1024.0);
+    unmapFile(&file);
+
+    double start = nowSeconds();
+    long legacyCount = loadStudentsLegacy(store, BENCH_ROSTER_FILE);
+    double legacyTime = nowSeconds() - start;
+    freeHashTable(store);
+
+    int requestedThreads = store->workerThreads;
+    store->workerThreads = 1;
+    start = nowSeconds();
+    loadStudentsFromFile(store, BENCH_ROSTER_FILE);
+    double serialTime = nowSeconds() - start;
+    long serialCount = store->hashTable.count;
+    uint32_t serialChecksum = tableChecksum(store);
+    freeHashTable(store);
+
+    store->workerThreads = requestedThreads;
+    start = nowSeconds();
+    loadStudentsFromFile(store, BENCH_ROSTER_FILE);
+    double parallelTime = nowSeconds() - start;
+    long parallelCount = store->hashTable.count;
+    uint32_t parallelChecksum = tableChecksum(store);
+    remove(BENCH_ROSTER_FILE);
+
+    printf("loadStudentsFromFile on %d lines (%.1f MB)\n", lines, megabytes);
+    printf("  fgets/sscanf     : %8.1f ms  %7.1f MB/s  %ld students\n", legacyTime * 1e3,
+           megabytes / legacyTime, legacyCount);
+    printf("  mmap, 1 thread   : %8.1f ms  %7.1f MB/s  %ld students\n", serialTime * 1e3,
+           megabytes / serialTime, serialCount);
+    printf("  mmap, %2d threads : %8.1f ms  %7.1f MB/s  %ld students\n", resolveThreadCount(store),
+           parallelTime * 1e3, megabytes / parallelTime, parallelCount);
+    printf("  table contents   : %s\n",
+           serialChecksum == parallelChecksum ? "identical" : "DIFFER");
+}
+
+int compareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+double percentile(const double *sorted, long count, double fraction)
+{
+    long index = (long) (fraction * (double) (count - 1) + 0.5);
+    return sorted[index];
+}
+
+#if HAVE_POSIX
+int connectToServer(const char *path)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *) &address, sizeof(address)) != 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+int transferAll(int fd, unsigned char *data, size_t size, int sending)
+{
+    while (size > 0)
+    {
+        ssize_t done = sending ? send(fd, data, size, MSG_NOSIGNAL) : recv(fd, data, size, 0);
+        if (done <= 0)
+        {
+            if (done < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        data += done;
+        size -= (size_t) done;
+    }
+    return 0;
+}
+
+// Sends one request and waits for its reply; returns the reply's status, or -1 if the
+// connection failed. The reply payload is copied into `reply` (SERVER_MAX_REPLY bytes).
+int callServer(int fd, int op, const void *payload, size_t size, unsigned char *reply)
+{
+    unsigned char frame[SERVER_MAX_REQUEST + 2];
+    uint16_t length = (uint16_t) (size + 1);
+    memcpy(frame, &length, sizeof(length));
+    frame[2] = (unsigned char) op;
+    memcpy(frame + 3, payload, size);
+    if (transferAll(fd, frame, size + 3, 1) != 0 || transferAll(fd, frame, 2, 0) != 0)
+    {
+        return -1;
+    }
+    memcpy(&length, frame, sizeof(length));
+    if (length == 0 || length > SERVER_MAX_REPLY ||
+        transferAll(fd, reply, length, 0) != 0)
+    {
+        return -1;
+    }
+    return reply[0];
+}
+
+int callServerMark(int fd, int32_t id, int subjectIndex, int day, int status, unsigned char *reply)
+{
+    unsigned char payload[7];
+    memcpy(payload, &id, sizeof(id));
+    payload[4] = (unsigned char) subjectIndex;
+    payload[5] = (unsigned char) (day + 1);
+    payload[6] = (unsigned char) (int8_t) status;
+    return callServer(fd, SERVER_MARK, payload, sizeof(payload), reply);
+}
+
+typedef struct LoadClient
+{
+    const char *path;
+    int subjectIndex;
+    const int *ids; // the roster's IDs, `students` of them
+    int students;
+    long requests;
+    uint32_t seed;
+    double *latencies; // seconds per request, in send order
+    long notFound;
+    int failed;
+} LoadClient;
+
+// One synthetic classroom terminal: nine marks for every view, each waiting for its reply.
+void *runLoadClient(void *arg)
+{
+    LoadClient *client = (LoadClient *) arg;
+    unsigned char reply[SERVER_MAX_REPLY];
+    int fd = connectToServer(client->path);
+    client->failed = fd < 0;
+    for (long i = 0; i < client->requests && !client->failed; i++)
+    {
+        uint32_t r = generatorRandom(&client->seed);
+        int32_t id = client->ids[r % (uint32_t) client->students];
+        r = generatorRandom(&client->seed);
+        double start = nowSeconds();
+        int status = r % 10 == 0 ? callServer(fd, SERVER_VIEW, &id, sizeof(id), reply)
+                                 : callServerMark(fd, id, client->subjectIndex,
+                                                  (int) ((r >> 8) % MAX_DAYS),
+                                                  (int) ((r >> 16) & 1), reply);
+        client->latencies[i] = nowSeconds() - start;
+        client->failed = status < 0 || status == SERVER_BAD_REQUEST || status == SERVER_FAILED;
+        client->notFound += status == SERVER_NOT_FOUND;
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    return NULL;
+}
+
+// Drives the server at `path` from `clients` connections sending `requests` in all, marking
+// `subject` for students drawn from `ids`, then prints throughput and latency.
+int generateLoad(const char *path, int clients, long requests, const int *ids, int students,
+                 const char *subject)
+{
+    unsigned char reply[SERVER_MAX_REPLY];
+    int fd = connectToServer(path);
+    if (fd < 0)
+    {
+        printf("Error: Could not connect to %s\n", path);
+        return -1;
+    }
+    int status = callServer(fd, SERVER_SUBJECT, subject, strlen(subject), reply);
+    close(fd);
+    if (status != SERVER_OK)
+    {
+        printf("Error: The server could not register subject %s\n", subject);
+        return -1;
+    }
+
+    LoadClient *loadClients = (LoadClient *) calloc((size_t) clients, sizeof(LoadClient));
+    pthread_t *handles = (pthread_t *) malloc((size_t) clients * sizeof(pthread_t));
+    int *started = (int *) calloc((size_t) clients, sizeof(int));
+    double *latencies = (double *) malloc((size_t) requests * sizeof(double));
+    if (!loadClients || !handles || !started || !latencies)
+    {
+        printf("Error: Memory allocation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+    long assigned = 0;
+    double start = nowSeconds();
+    for (int c = 0; c < clients; c++)
+    {
+        LoadClient *client = &loadClients[c];
+        client->path = path;
+        client->subjectIndex = reply[1];
+        client->ids = ids;
+        client->students = students;
+        client->requests = requests / clients + (c < requests % clients);
+        client->seed = (uint32_t) (c + 1) * 2654435761u;
+        client->latencies = latencies + assigned;
+        assigned += client->requests;
+        started[c] = pthread_create(&handles[c], NULL, runLoadClient, client) == 0;
+    }
+    long notFound = 0;
+    int failed = 0;
+    for (int c = 0; c < clients; c++)
+    {
+        if (started[c])
+        {
+            pthread_join(handles[c], NULL);
+        }
+        else
+        {
+            runLoadClient(&loadClients[c]);
+        }
+        notFound += loadClients[c].notFound;
+        failed += loadClients[c].failed;
+    }
+    double elapsed = nowSeconds() - start;
+
+    if (failed)
+    {
+        printf("Error: %d clients lost their connection.\n", failed);
+    }
+    else
+    {
+        qsort(latencies, (size_t) requests, sizeof(double), compareDoubles);
+        printf("%ld requests from %d clients in %.2f s: %.0f requests/s\n", requests, clients,
+               elapsed, requests / elapsed);
+        printf("  latency us  p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+               percentile(latencies, requests, 0.5) * 1e6,
+               percentile(latencies, requests, 0.9) * 1e6,
+               percentile(latencies, requests, 0.99) * 1e6,
+               percentile(latencies, requests, 0.999) * 1e6, latencies[requests - 1] * 1e6);
+        if (notFound)
+        {
+            printf("  %ld requests named unknown students.\n", notFound);
+        }
+    }
+    free(loadClients);
+    free(handles);
+    free(started);
+    free(latencies);
+    return failed ? -1 : 0;
+}
+#endif
+
+// loadgen SOCKET [clients] [requests] [students] [subject] [seed]: the students are those of
+// `--generate roster FILE students seed`, so the server should have that roster loaded.
+int runLoadGenerator(int argc, char *argv[])
+{
+#if HAVE_POSIX
+    int clients = argc > 1 ? atoi(argv[1]) : LOADGEN_DEFAULT_CLIENTS;
+    long requests = argc > 2 ? atol(argv[2]) : LOADGEN_DEFAULT_REQUESTS;
+    int students = argc > 3 ? atoi(argv[3]) : BENCH_DEFAULT_STUDENTS;
+    const char *subject = argc > 4 ? argv[4] : LOADGEN_DEFAULT_SUBJECT;
+    uint32_t seed = argc > 5 ? (uint32_t) strtoul(argv[5], NULL, 10) : GENERATOR_DEFAULT_SEED;
+    if (argc < 1 || clients <= 0 || requests <= 0 || students <= 0 ||
+        strlen(subject) >= MAX_NAME_LEN)
+    {
+        printf("Error: Usage: loadgen SOCKET [clients] [requests] [students] [subject] [seed]\n");
+        return 1;
+    }
+    int *ids = generateRosterIds(students, seed);
+    if (!ids)
+    {
+        return 1;
+    }
+    int failed = generateLoad(argv[0], clients, requests, ids, students, subject) != 0;
+    free(ids);
+    return failed ? 1 : 0;
+#else
+    (void) argc;
+    (void) argv;
+    printf("Error: The load generator needs Unix domain sockets.\n");
+    return 1;
+#endif
+}
+
+// Microbenchmarks of the core operations at several table sizes. Fast operations are timed in
+// batches (a single call is too short for the clock), after warm-up batches, and the percentiles
+// are over the per-operation time of each batch.
+typedef enum MicroOp
+{
+    MICRO_LOAD,
+    MICRO_INSERT,
+    MICRO_SEARCH,
+    MICRO_SEARCH_SUFFIX,
+    MICRO_MARK,
+    MICRO_PERCENTAGE,
+    MICRO_REPORT,
+    MICRO_DELETE,
+    MICRO_OPS
+} MicroOp;
+
+const char *microOpNames[] = {"load",           "insert",     "search", "search_suffix",
+                              "mark",           "percentage", "report", "delete"};
+
+typedef struct MicroState
+{
+    int count;
+    int batch;
+    const int *ids;   // the generated roster, in file order
+    const int *order; // a shuffled permutation of 0..count-1; each batch takes the next slice
+    long cursor;
+    uint32_t seed;
+    int nextNewId;    // inserts use IDs above the generated series
+    Student **picked;
+    Student *removed; // copies of deleted students, reinserted after each delete batch
+    long sink;        // results are summed here so the calls cannot be optimised away
+} MicroState;
+
+typedef struct MicroResult
+{
+    MicroOp op;
+    int students;
+    int batch;
+    int samples;
+    double nsPerOp;
+    double p50, p90, p99, min, max;
+} MicroResult;
+
+// Gives every student random marks on every subject straight into the bitmaps, then accounts
+// them in bulk, which is far quicker than setAttendance day by day at ten million students.
+void fillGeneratedAttendance(AttendanceStore *store, const int *ids, int count, uint32_t seed)
+{
+    for (int i = store->subjectCount; i < MAX_SUBJECTS; i++)
+    {
+        getSubjectIndex(store, generatorSubjects[i]);
+    }
+    for (int i = 0; i < count; i++)
+    {
+        Student *student = findStudent(store, ids[i]);
+        int rate = generatedAttendanceRate(ids[i]);
+        student->totals = (AttendanceTotals) {0, 0};
+        for (int subject = 0; subject < MAX_SUBJECTS; subject++)
+        {
+            uint32_t recorded = generatorRandom(&seed) & 0x7fffffffu;
+            uint32_t present = 0;
+            for (uint32_t bits = recorded; bits; bits &= bits - 1)
+            {
+                present |= (int) (generatorRandom(&seed) % 100) < rate ? bits & -bits : 0;
+            }
+            student->subjects[subject] = (AttendanceRecord) {recorded, present};
+            student->totals.recorded += popcount32(recorded);
+            student->totals.present += popcount32(present);
+        }
+        accountStudent(store, student, 1);
+    }
+}
+
+int nextMicroIndex(MicroState *state)
+{
+    return state->order[state->cursor++ % state->count];
+}
+
+// Runs one batch of `op` and returns the seconds it took. Anything the batch needs, or has to
+// undo so the table keeps its size, happens outside the timed part.
+double runMicroBatch(AttendanceStore *store, MicroOp op, MicroState *state)
+{
+    int batch = op == MICRO_LOAD || op == MICRO_REPORT ? 1 : state->batch;
+    int subject = 0;
+    if (op == MICRO_LOAD)
+    {
+        freeHashTable(store);
+    }
+    else if (op == MICRO_PERCENTAGE)
+    {
+        for (int i = 0; i < batch; i++)
+        {
+            state->picked[i] = findStudent(store, state->ids[nextMicroIndex(state)]);
+        }
+    }
+    else if (op == MICRO_DELETE)
+    {
+        for (int i = 0; i < batch; i++)
+        {
+            state->removed[i] = *findStudent(store, state->ids[nextMicroIndex(state)]);
+        }
+    }
+
+    long sink = 0;
+    double start = nowSeconds();
+    switch (op)
+    {
+    case MICRO_LOAD:
+        loadStudentsFromFile(store, BENCH_ROSTER_FILE);
+        sink = store->hashTable.count;
+        break;
+    case MICRO_INSERT:
+        for (int i = 0; i < batch; i++)
+        {
+            sink += insertStudent(store, state->nextNewId + i, "Micro Benchmark")->id;
+        }
+        break;
+    case MICRO_SEARCH:
+        for (int i = 0; i < batch; i++)
+        {
+            sink += searchStudentById(store, state->ids[nextMicroIndex(state)]) != NULL;
+        }
+        break;
+    case MICRO_SEARCH_SUFFIX:
+        for (int i = 0; i < batch; i++)
+        {
+            int suffix = state->ids[nextMicroIndex(state)] % ID_SUFFIX_SLOTS;
+            sink += searchStudentById(store, suffix) != NULL;
+        }
+        break;
+    case MICRO_MARK:
+        for (int i = 0; i < batch; i++)
+        {
+            uint32_t r = generatorRandom(&state->seed);
+            Student *student = findStudent(store, state->ids[nextMicroIndex(state)]);
+            markStudent(store, student, (int) (r % MAX_SUBJECTS), (int) ((r >> 8) % MAX_DAYS),
+                        (int) ((r >> 16) & 1));
+        }
+        break;
+    case MICRO_PERCENTAGE:
+        for (int i = 0; i < batch; i++)
+        {
+            sink += total_percentage(state->picked[i]);
+        }
+        break;
+    case MICRO_REPORT:
+        sink = generateReports(store, &subject, 1, BENCH_REPORT_FILE, 1, REPORT_TEXT);
+        break;
+    case MICRO_DELETE:
+        for (int i = 0; i < batch; i++)
+        {
+            sink += removeStudent(store, state->removed[i].id);
+        }
+        break;
+    default:
+        break;
+    }
+    double elapsed = nowSeconds() - start;
+    state->sink += sink;
+
+    if (op == MICRO_INSERT)
+    {
+        for (int i = 0; i < batch; i++)
+        {
+            removeStudent(store, state->nextNewId + i);
+        }
+    }
+    else if (op == MICRO_DELETE)
+    {
+        for (int i = 0; i < batch; i++)
+        {
+            const Student *copy = &state->removed[i];
+            Student *student = insertStudent(store, copy->id, copy->name);
+            memcpy(student->subjects, copy->subjects, sizeof(copy->subjects));
+            student->totals = copy->totals;
+            accountStudent(store, student, 1);
+        }
+    }
+    return elapsed;
+}
+
+MicroResult measureMicroOp(AttendanceStore *store, MicroOp op, MicroState *state)
+{
+    int slow = op == MICRO_LOAD || op == MICRO_REPORT;
+    MicroResult result = {op, state->count, slow ? 1 : state->batch, 0, 0, 0, 0, 0, 0, 0};
+    int warmup = slow ? 1 : BENCH_MICRO_WARMUP;
+    result.samples = !slow ? BENCH_MICRO_SAMPLES
+                           : state->count >= 1000000 ? 3 : BENCH_MICRO_SLOW_SAMPLES;
+    double samples[BENCH_MICRO_SAMPLES];
+    for (int i = 0; i < warmup; i++)
+    {
+        runMicroBatch(store, op, state);
+    }
+    double total = 0;
+    for (int i = 0; i < result.samples; i++)
+    {
+        samples[i] = runMicroBatch(store, op, state) * 1e9 / result.batch;
+        total += samples[i];
+    }
+    qsort(samples, (size_t) result.samples, sizeof(double), compareDoubles);
+    result.nsPerOp = total / result.samples;
+    result.p50 = percentile(samples, result.samples, 0.5);
+    result.p90 = percentile(samples, result.samples, 0.9);
+    result.p99 = percentile(samples, result.samples, 0.99);
+    result.min = samples[0];
+    result.max = samples[result.samples - 1];
+    return result;
+}
+
+void writeMicroResult(FILE *file, const MicroResult *result, ReportFormat format)
+{
+    const char *name = microOpNames[result->op];
+    if (format == REPORT_JSON)
+    {
+        fprintf(file,
+                "{\"op\":\"%s\",\"students\":%d,\"batch\":%d,\"samples\":%d,\"ns_per_op\":%.1f,"
+                "\"ops_per_sec\":%.0f,\"p50_ns\":%.1f,\"p90_ns\":%.1f,\"p99_ns\":%.1f,"
+                "\"min_ns\":%.1f,\"max_ns\":%.1f}\n",
+                name, result->students, result->batch, result->samples, result->nsPerOp,
+                1e9 / result->nsPerOp, result->p50, result->p90, result->p99, result->min,
+                result->max);
+    }
+    else if (format == REPORT_CSV)
+    {
+        fprintf(file, "%s,%d,%d,%d,%.1f,%.0f,%.1f,%.1f,%.1f,%.1f,%.1f\n", name,
+                result->students, result->batch, result->samples, result->nsPerOp,
+                1e9 / result->nsPerOp, result->p50, result->p90, result->p99, result->min,
+                result->max);
+    }
+    else
+    {
+        fprintf(file, "%-14s %9d %13.1f %13.0f %13.1f %13.1f %13.1f\n", name, result->students,
+                result->nsPerOp, 1e9 / result->nsPerOp, result->p50, result->p90, result->p99);
+    }
+}
+
+// Every core operation at 1,000, 10,000, 100,000... students up to `maxStudents`. The table goes
+// to stdout; with `filename` the results are also written there as CSV or JSON lines.
+void benchMicro(AttendanceStore *store, int maxStudents, const char *filename, ReportFormat format)
+{
+    int sizes[8];
+    int sizeCount = 0;
+    if (maxStudents < 2 || maxStudents > GENERATOR_MAX_STUDENTS)
+    {
+        printf("Error: Microbenchmarks run on 2 to %d students.\n", GENERATOR_MAX_STUDENTS);
+        return;
+    }
+    for (int size = 1000; size < maxStudents; size *= 10)
+    {
+        sizes[sizeCount++] = size;
+    }
+    sizes[sizeCount++] = maxStudents;
+
+    FILE *output = NULL;
+    if (filename && !(output = fopen(filename, "w")))
+    {
+        printf("Error: Could not open file %s for writing\n", filename);
+        return;
+    }
+
+    MicroResult results[MICRO_OPS * 8];
+    int resultCount = 0;
+    long sink = 0;
+    for (int s = 0; s < sizeCount; s++)
+    {
+        int count = sizes[s];
+        int batch = count / 2 < BENCH_MICRO_BATCH ? count / 2 : BENCH_MICRO_BATCH;
+        int *ids = generateRosterIds(count, GENERATOR_DEFAULT_SEED);
+        int *order = (int *) malloc(count * sizeof(int));
+        MicroState state = {count, batch, ids, order, 0, 777, 600000000, NULL, NULL, 0};
+        state.picked = (Student **) malloc(state.batch * sizeof(Student *));
+        state.removed = (Student *) malloc(state.batch * sizeof(Student));
+        if (!ids || !order || !state.picked || !state.removed)
+        {
+            printf("Error: Memory allocation failed!\n");
+            exit(EXIT_FAILURE);
+        }
+        uint32_t seed = 31337;
+        for (int i = 0; i < count; i++)
+        {
+            int j = (int) (generatorRandom(&seed) % (uint32_t) (i + 1));
+            order[i] = order[j];
+            order[j] = i;
+        }
+        if (writeGeneratedRoster(BENCH_ROSTER_FILE, count, GENERATOR_DEFAULT_SEED, NULL) != 0)
+        {
+            exit(EXIT_FAILURE);
+        }
+
+        // Loading leaves the table filled; the other operations run on it in turn, quietly so
+        // stdout holds only the results table.
+        store->quiet = 1;
+        for (int op = 0; op < MICRO_OPS; op++)
+        {
+            if (op == MICRO_INSERT)
+            {
+                fillGeneratedAttendance(store, ids, count, seed);
+            }
+            results[resultCount++] = measureMicroOp(store, (MicroOp) op, &state);
+        }
+        store->quiet = 0;
+        sink += state.sink;
+        remove(BENCH_ROSTER_FILE);
+        remove(BENCH_REPORT_FILE);
+        freeHashTable(store);
+        free(ids);
+        free(order);
+        free(state.picked);
+        free(state.removed);
+    }
+
+    const char *heading = "%-14s %9s %13s %13s %13s %13s %13s\n";
+    printf("\n");
+    printf(heading, "operation", "students", "ns/op", "ops/s", "p50 ns", "p90 ns", "p99 ns");
+    if (output && format == REPORT_TEXT)
+    {
+        fprintf(output, heading, "operation", "students", "ns/op", "ops/s", "p50 ns", "p90 ns",
+                "p99 ns");
+    }
+    else if (output && format == REPORT_CSV)
+    {
+        fprintf(output, "op,students,batch,samples,ns_per_op,ops_per_sec,p50_ns,p90_ns,p99_ns,"
+                        "min_ns,max_ns\n");
+    }
+    for (int i = 0; i < resultCount; i++)
+    {
+        writeMicroResult(stdout, &results[i], REPORT_TEXT);
+        if (output)
+        {
+            writeMicroResult(output, &results[i], format);
+        }
+    }
+    if (output)
+    {
+        int failed = fclose(output) != 0;
+        printf(failed ? "Error: Could not write %s\n" : "Results written to %s\n", filename);
+    }
+    printf("(checksum %ld)\n", sink);
+}
+
+#if HAVE_EPOLL
+void *runBenchServer(void *arg)
+{
+    AttendanceStore *store = (AttendanceStore *) arg;
+    snprintf(store->server.reportDir, sizeof(store->server.reportDir), "."); // sends no reports
+    runServer(store, BENCH_SOCKET_FILE, resolveThreadCount(store));
+    return NULL;
+}
+#endif
+
+// Serves a generated roster from a background thread and runs the load generator against it
+// over a real socket, so the numbers include the protocol and the event loop.
+void benchServer(AttendanceStore *store, long requests)
+{
+#if HAVE_EPOLL
+    populateBenchStudents(store, BENCH_DEFAULT_STUDENTS);
+    pthread_t handle;
+    if (pthread_create(&handle, NULL, runBenchServer, store) != 0)
+    {
+        printf("Error: Could not start the server thread.\n");
+        return;
+    }
+    struct timespec pause = {0, 1000000};
+    while (__atomic_load_n(&store->server.running, __ATOMIC_ACQUIRE) == 0)
+    {
+        nanosleep(&pause, NULL);
+    }
+    if (store->server.running > 0)
+    {
+        int *ids = (int *) malloc(BENCH_DEFAULT_STUDENTS * sizeof(int));
+        if (!ids)
+        {
+            printf("Error: Memory allocation failed!\n");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < BENCH_DEFAULT_STUDENTS; i++)
+        {
+            ids[i] = 590000000 + i; // populateBenchStudents' IDs
+        }
+        generateLoad(BENCH_SOCKET_FILE, LOADGEN_DEFAULT_CLIENTS, requests, ids,
+                     BENCH_DEFAULT_STUDENTS, "SUBJECT1");
+        free(ids);
+        stopServer(store);
+    }
+    pthread_join(handle, NULL);
+#else
+    (void) requests;
+    printf("Error: Server mode needs epoll and is only available on Linux.\n");
+#endif
+}
+
+int runBenchmark(AttendanceStore *store, int argc, char *argv[])
+{
+    const char *name = argc > 0 ? argv[0] : "percentage";
+    int count = argc > 1 ? atoi(argv[1]) : 0;
+    if (argc > 1 && count <= 0)
+    {
+        printf("Error: Invalid student count.\n");
+        return 1;
+    }
+
+    if (strcmp(name, "percentage") == 0)
+    {
+        benchPercentage(store, count ? count : BENCH_DEFAULT_STUDENTS);
+    }
+    else if (strcmp(name, "load") == 0)
+    {
+        benchLoad(store, count ? count : BENCH_DEFAULT_ROSTER_LINES);
+    }
+    else if (strcmp(name, "snapshot") == 0)
+    {
+        benchSnapshot(store, count ? count : BENCH_DEFAULT_STUDENTS);
+    }
+    else if (strcmp(name, "report") == 0)
+    {
+        benchReport(store, count ? count : BENCH_DEFAULT_STUDENTS);
+    }
+    else if (strcmp(name, "names") == 0)
+    {
+        benchNames(store, count ? count : BENCH_DEFAULT_STUDENTS);
+    }
+    else if (strcmp(name, "range") == 0)
+    {
+        benchRange(store, count ? count : BENCH_DEFAULT_STUDENTS);
+    }
+    else if (strcmp(name, "concurrent") == 0)
+    {
+        benchConcurrent(store, count ? count : BENCH_DEFAULT_CONCURRENT_MARKS);
+    }
+    else if (strcmp(name, "micro") == 0)
+    {
+        int format = argc > 3 ? parseReportFormat(argv[3]) : REPORT_CSV;
+        if (format < 0)
+        {
+            return 1;
+        }
+        benchMicro(store, count ? count : BENCH_DEFAULT_STUDENTS, argc > 2 ? argv[2] : NULL,
+                   format);
+    }
+    else if (strcmp(name, "server") == 0)
+    {
+        benchServer(store, count ? count : LOADGEN_DEFAULT_REQUESTS);
+    }
+    else if (strcmp(name, "rank") == 0)
+    {
+        benchRank(store, count ? count : BENCH_DEFAULT_RANK_STUDENTS);
+    }
+    else if (strcmp(name, "import") == 0)
+    {
+        benchImport(store, count ? count : BENCH_DEFAULT_IMPORT_MARKS);
+    }
+    else if (strcmp(name, "journal") == 0)
+    {
+        benchJournal(store, count ? count : BENCH_DEFAULT_JOURNAL_MARKS);
+    }
+    else
+    {
+        printf("Error: Unknown benchmark %s\n", name);
+        return 1;
+    }
+    return 0;
+}
+
+// attendance_bench [--threads N] NAME [count] runs one benchmark on a fresh store;
+// attendance_bench loadgen SOCKET ... drives a running server instead.
+int main(int argc, char *argv[])
+{
+    AttendanceStore *store = createStore();
+    int arg = 1;
+    if (arg + 1 < argc && strcmp(argv[arg], "--threads") == 0)
+    {
+        store->workerThreads = atoi(argv[arg + 1]);
+        arg += 2;
+    }
+
+    int status;
+    if (arg < argc && strcmp(argv[arg], "loadgen") == 0)
+    {
+        status = runLoadGenerator(argc - arg - 1, argv + arg + 1);
+    }
+    else
+    {
+        status = runBenchmark(store, argc - arg, argv + arg);
+    }
+    destroyStore(store);
+    return status;
+}
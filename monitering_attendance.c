@@ -1,171 +1,77 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define TABLE_SIZE 10
-#define MAX_NAME_LEN 50
-#define MAX_LINE_LEN 100
-#define MAX_SUBJECTS 10
-#define MAX_DAYS 31
-#define RESET "\033[0m"
-#define RED "\033[31m"
-#define GREEN "\033[32m"
-#define YELLOW "\033[33m"
-#define BLUE "\033[34m"
-#define MAGENTA "\033[35m"
-#define CYAN "\033[36m"
-#define BOLD "\033[1m"
-
-typedef struct AttendanceRecord
-{
-    int days[MAX_DAYS];
-} AttendanceRecord;
-
-typedef struct Student
-{
-    int id;
-    char name[MAX_NAME_LEN];
-    AttendanceRecord subjects[MAX_SUBJECTS];
-    struct Student *next;
-} Student;
-
-Student *hashTable[TABLE_SIZE] = {NULL};
-char subjectList[MAX_SUBJECTS][MAX_NAME_LEN];
-int subjectCount = 0;
+#include "attendance.h"
 
-int hashFunction(int id)
+void printSuffixMatches(AttendanceStore *store, int suffix)
 {
-    return id % TABLE_SIZE;
+    printf("Last 4 digits %04d are shared by several students, enter the full ID instead:\n",
+           suffix);
+    for (Student *current = store->suffixIndex[suffixSlot(suffix)]; current != NULL;
+         current = current->suffixNext)
+    {
+        printf("  %d  %s\n", current->id, current->name);
+    }
 }
 
-Student *createStudent(int id, const char *name)
+int searchStudentsByName(AttendanceStore *store, const char *prefix)
 {
-    Student *newStudent = (Student *) malloc(sizeof(Student));
-    if (!newStudent)
+    while (*prefix == ' ' || *prefix == '\t')
     {
-        printf("Error: Memory allocation failed.\n");
-        exit(EXIT_FAILURE);
+        prefix++;
     }
-    newStudent->id = id;
-    strncpy(newStudent->name, name, MAX_NAME_LEN - 1);
-    newStudent->name[MAX_NAME_LEN - 1] = '\0';
-    for (int i = 0; i < MAX_SUBJECTS; i++)
+    if (*prefix == '\0')
     {
-        for (int j = 0; j < MAX_DAYS; j++)
-        {
-            newStudent->subjects[i].days[j] = -1;
-        }
+        printf("Error: Enter at least one character of the name.\n");
+        return -1;
     }
-    newStudent->next = NULL;
-    return newStudent;
-}
-
-void insertStudent(int id, const char *name)
-{
-    int index = hashFunction(id);
-    Student *newStudent = createStudent(id, name);
-    newStudent->next = hashTable[index];
-    hashTable[index] = newStudent;
-}
-
-Student *searchStudentById(int id)
-{
-    int lastFourDigits = id % 10000;
-    for (int i = 0; i < TABLE_SIZE; i++)
+    Student **matches;
+    long count = findStudentsByName(store, prefix, &matches);
+    if (count == 0)
     {
-        Student *current = hashTable[i];
-        while (current != NULL)
-        {
-            if (current->id % 10000 == lastFourDigits)
-            {
-                return current;
-            }
-            current = current->next;
-        }
+        printf("No student name matches \"%s\".\n", prefix);
     }
-    return NULL;
-}
-
-int total_percentage(Student *student)
-{
-    int present = 0, total = 0;
-
-    for (int i = 0; i < subjectCount; i++)
+    for (long i = 0; i < count; i++)
     {
-        for (int day = 0; day < MAX_DAYS; day++)
-        {
-            if (student->subjects[i].days[day] != -1)
-            {
-                total++;
-                if (student->subjects[i].days[day] == 1)
-                {
-                    present++;
-                }
-            }
-        }
+        printf("  %-10d %s\n", matches[i]->id, matches[i]->name);
     }
-
-    if (total == 0) return 0;
-    float percentage = (float)present / total * 100;
-    return (int)(percentage + 0.5f);
-}
-
-void deleteStudentById(int id)
-{
-    int index = hashFunction(id);
-    Student *current = hashTable[index];
-    Student *prev = NULL;
-
-    while (current != NULL)
+    if (count > 0)
     {
-        if (current->id == id)
-        {
-            if (prev == NULL)
-            {
-                hashTable[index] = current->next;
-            }
-            else
-            {
-                prev->next = current->next;
-            }
-            free(current);
-            printf("Student with ID %d deleted successfully.\n", id);
-            return;
-        }
-        prev = current;
-        current = current->next;
+        printf("%ld student%s matched.\n", count, count == 1 ? "" : "s");
     }
-
-    printf("Student with ID %d not found.\n", id);
+    free(matches);
+    return 0;
 }
 
-int getSubjectIndex(const char *subject)
+int listStudentsInRange(AttendanceStore *store, int low, int high)
 {
-    for (int i = 0; i < subjectCount; i++)
+    Student **matches;
+    long count = findStudentsInRange(store, low, high, &matches);
+    printf("Students with IDs %d to %d:\n", low, high);
+    for (long i = 0; i < count; i++)
     {
-        if (strcmp(subjectList[i], subject) == 0)
-        {
-            return i;
-        }
+        printf("  %-10d %-30s %3d%%\n", matches[i]->id, matches[i]->name,
+               percentageOf(matches[i]->totals));
     }
-    if (subjectCount < MAX_SUBJECTS)
-    {
-        strncpy(subjectList[subjectCount], subject, MAX_NAME_LEN - 1);
-        subjectList[subjectCount][MAX_NAME_LEN - 1] = '\0';
-        return subjectCount++;
-    }
-    printf("Error: Maximum number of subjects reached.\n");
-    return -1;
+    printf("%ld student%s listed.\n", count, count == 1 ? "" : "s");
+    free(matches);
+    return 0;
 }
 
-void markAttendance()
+void markAttendance(AttendanceStore *store)
 {
     char subject[MAX_NAME_LEN];
     int day;
 
     printf("Enter the subject name: ");
     scanf("%s", subject);
-    int subjectIndex = getSubjectIndex(subject);
+    int subjectIndex = getSubjectIndex(store, subject);
     if (subjectIndex == -1)
     {
         return;
@@ -178,15 +84,7 @@ void markAttendance()
         return;
     }
 
-    for (int i = 0; i < TABLE_SIZE; i++)
-    {
-        Student *current = hashTable[i];
-        while (current != NULL)
-        {
-            current->subjects[subjectIndex].days[day - 1] = 0;
-            current = current->next;
-        }
-    }
+    beginRollCall(store, subjectIndex, day - 1);
 
     int id = 0;
     printf(
@@ -194,31 +92,19 @@ void markAttendance()
         subject, day);
     while (scanf("%d", &id) && id != -1)
     {
-        Student *student = NULL;
-        for (int i = 0; i < TABLE_SIZE; i++)
-        {
-            Student *current = hashTable[i];
-            while (current != NULL)
-            {
-                if (current->id % 10000 == id)
-                {
-                    student = current;
-                    break;
-                }
-                current = current->next;
-            }
-            if (student)
-            {
-                break;
-            }
-        }
+        int matches;
+        Student *student = lookupStudent(store, id, &matches);
 
         if (student)
         {
-            student->subjects[subjectIndex].days[day - 1] = 1; // Mark as present
+            markStudent(store, student, subjectIndex, day - 1, 1); // Mark as present
             printf("Marked %s (ID: %d) as present for %s on day %d.\n", student->name, student->id,
                    subject, day);
         }
+        else if (matches > 1)
+        {
+            printSuffixMatches(store, id);
+        }
         else
         {
             printf("Student with last 4 digits of ID %d not found.\n", id);
@@ -227,203 +113,647 @@ void markAttendance()
                "to stop): ",
                subject, day);
     }
+    journalCommit(store);
+}
+
+// Prints the day-by-day table for every subject; batch mode passes useColor = 0 for plain text.
+void printAttendance(AttendanceStore *store, const Student *student, int useColor)
+{
+    const char *heading = useColor ? BOLD BLUE : "";
+    const char *present = useColor ? GREEN "P" RESET : "P";
+    const char *absent = useColor ? RED "A" RESET : "A";
+    const char *reset = useColor ? RESET : "";
+
+    printf("\nAttendance for %s (ID: %d):\n", student->name, student->id);
+    printf("=============================================================================================\n");
+
+    for (int part = 0; part < 3; part++)
+    {
+        int startDay = part * 10 + 1;
+        int endDay = (part == 2) ? MAX_DAYS : startDay + 9;
+
+        printf("| %s%-15s%s", heading, "Subject", reset);
+        for (int day = startDay; day <= endDay; day++)
+        {
+            printf("| %sDay%-2d %s", heading, day, reset);
+        }
+        printf("|\n");
+        printf("-----------------------------------------------------------------------------------------------\n");
+
+        for (int i = 0; i < store->subjectCount; i++)
+        {
+            printf("| %s%-15s%s", heading, store->subjectList[i], reset);
+            for (int day = startDay - 1; day < endDay; day++)
+            {
+                int status = getAttendance(student, i, day);
+                if (status == -1)
+                {
+                    printf("| %-5s ", "NULL");
+                }
+                else if (status == 1)
+                {
+                    printf("| %s   ", present);
+                }
+                else
+                {
+                    printf("| %s   ", absent);
+                }
+            }
+            printf("|\n");
+        }
+        printf("----------------------------------------------------------------------------------------------\n");
+    }
+
+    int percentage = total_percentage((Student *) student);
+    printf("\nTotal Attendance Percentage: %d%%\n", percentage);
+    if (isBelowThreshold(studentAttendance(student), ATTENDANCE_THRESHOLD))
+    {
+        printf("%sWarning: Attendance is below %d%%.%s\n", useColor ? RED : "",
+               ATTENDANCE_THRESHOLD, reset);
+    }
 }
 
-void loadStudentsFromFile(const char *filename)
+void viewAttendance(AttendanceStore *store)
 {
-    FILE *file = fopen(filename, "r");
-    if (!file)
+    int id;
+    printf("Enter student ID to view attendance: ");
+    if (scanf("%d", &id) != 1)
     {
-        printf("Error: Could not open file %s\n", filename);
+        printf("Error: Invalid input for ID.\n");
         return;
     }
 
-    char line[MAX_LINE_LEN];
-    while (fgets(line, sizeof(line), file))
+    int matches;
+    Student *student = lookupStudent(store, id, &matches);
+    if (!student)
     {
-        int id;
-        char name[MAX_NAME_LEN];
-        if (sscanf(line, "%d,%49[^\n]", &id, name) == 2)
+        if (matches > 1)
         {
-            insertStudent(id, name);
+            printSuffixMatches(store, id);
         }
         else
         {
-            printf("Warning: Skipping invalid line: %s", line);
+            printf("Student with ID %d not found.\n", id);
         }
+        return;
     }
 
-    fclose(file);
-    printf("Students loaded successfully from %s\n", filename);
+    printAttendance(store, student, 1);
+}
+
+void printColoredMessage(const char *message, const char *color)
+{
+    printf("%s%s%s\n", color, message, RESET);
 }
 
-void generateReport(const char *filename, const char *subject)
+void printMemoryStats(AttendanceStore *store)
 {
-    FILE *file = fopen(filename, "w");
-    if (!file)
+    StudentAllocator *allocator = &store->studentAllocator;
+    size_t slabBytes = (size_t) allocator->slabCount * sizeof(StudentSlab);
+    size_t tableBytes =
+        (size_t) (store->hashTable.size + store->hashTable.oldSize) * sizeof(Student *);
+    size_t indexBytes = sizeof(store->suffixIndex);
+    size_t nameBytes = (size_t) store->nameIndex.capacity * sizeof(NameEntry);
+    size_t idBytes = (size_t) store->idIndex.capacity * sizeof(IdEntry);
+    size_t totalBytes = slabBytes + tableBytes + indexBytes + nameBytes + idBytes;
+
+    printf("Students live: %ld (%ld allocations, %ld records on the free list)\n",
+           allocator->liveCount, allocator->totalAllocations, allocator->freeCount);
+    printf("Slabs: %d x %d records of %zu bytes = %zu bytes\n", allocator->slabCount,
+           SLAB_STUDENTS, sizeof(Student), slabBytes);
+    printf("Hash table: %d buckets (load factor %.2f%s) = %zu bytes\n", store->hashTable.size,
+           hashTableLoadFactor(store), store->hashTable.oldBuckets ? ", rehashing" : "",
+           tableBytes);
+    printf("Suffix index: %zu bytes\n", indexBytes);
+    printf("Name index: %ld words (%ld unsorted, %ld deleted) = %zu bytes\n",
+           store->nameIndex.count, store->nameIndex.count - store->nameIndex.sortedCount,
+           store->nameIndex.removed, nameBytes);
+    printf("ID index: %ld entries (%ld unsorted, %ld deleted) = %zu bytes\n", store->idIndex.count,
+           store->idIndex.count - store->idIndex.sortedCount, store->idIndex.removed, idBytes);
+    if (allocator->liveCount > 0)
     {
-        printf("Error: Could not open file %s for writing\n", filename);
-        return;
+        printf("Total: %zu bytes, %.1f bytes per student\n", totalBytes,
+               (double) totalBytes / allocator->liveCount);
     }
+    else
+    {
+        printf("Total: %zu bytes\n", totalBytes);
+    }
+}
 
-    int subjectIndex = getSubjectIndex(subject);
-    if (subjectIndex == -1)
+// Parses a whole batch-mode argument as an int, reporting `what` was invalid if it is not one.
+int parseBatchInt(const char *token, const char *what, int *value)
+{
+    char *end;
+    errno = 0;
+    long parsed = strtol(token, &end, 10);
+    if (*token == '\0' || *end != '\0' || errno == ERANGE || parsed < INT_MIN || parsed > INT_MAX)
     {
-        fclose(file);
-        return;
+        printf("Error: Invalid %s %s\n", what, token);
+        return -1;
     }
+    *value = (int) parsed;
+    return 0;
+}
 
-    int minDay = MAX_DAYS + 1, maxDay = 0;
-    for (int i = 0; i < TABLE_SIZE; i++)
+// Resolves a batch-mode ID argument the same way the menus do, reporting failures.
+Student *resolveBatchStudent(AttendanceStore *store, const char *token)
+{
+    int id;
+    if (parseBatchInt(token, "student ID", &id) != 0)
     {
-        Student *current = hashTable[i];
-        while (current != NULL)
+        return NULL;
+    }
+    int matches;
+    Student *student = lookupStudent(store, id, &matches);
+    if (!student)
+    {
+        if (matches > 1)
         {
-            for (int day = 0; day < MAX_DAYS; day++)
-            {
-                if (current->subjects[subjectIndex].days[day] != -1)
-                {
-                    if (day + 1 < minDay)
-                        minDay = day + 1;
-                    if (day + 1 > maxDay)
-                        maxDay = day + 1;
-                }
-            }
-            current = current->next;
+            printSuffixMatches(store, id);
+        }
+        else
+        {
+            printf("Student with ID %d not found.\n", id);
         }
     }
+    return student;
+}
 
-    if (minDay > maxDay)
+// mark/present/absent SUBJECT DAY ID...: `mark` starts a roll call (everyone absent) and marks the
+// listed students present; `present` and `absent` only touch the listed students.
+int batchMark(AttendanceStore *store, const char *command, char **saveptr)
+{
+    char *subject = strtok_r(NULL, " \t", saveptr);
+    char *dayToken = strtok_r(NULL, " \t", saveptr);
+    int day = 0;
+    if (dayToken && parseBatchInt(dayToken, "day", &day) != 0)
     {
-        printf("No attendance data available for subject %s.\n", subject);
-        fclose(file);
-        return;
+        return -1;
     }
-
-    fprintf(file, "%s Attendance Report\n", subject);
-    fprintf(file, "%-10s %-30s", "ID", "Name");
-    for (int day = minDay; day <= maxDay; day++)
+    if (!subject || day < 1 || day > MAX_DAYS)
+    {
+        printf("Error: Usage: %s SUBJECT DAY ID...\n", command);
+        return -1;
+    }
+    int subjectIndex = getSubjectIndex(store, subject);
+    if (subjectIndex == -1)
     {
-        fprintf(file, " Day%-2d", day);
+        return -1;
     }
-    fprintf(file, "\n");
-    fprintf(
-        file,
-        "--------------------------------------------------------------------------------------\n");
 
-    for (int i = 0; i < TABLE_SIZE; i++)
+    int status = strcmp(command, "absent") == 0 ? 0 : 1;
+    if (strcmp(command, "mark") == 0)
     {
-        Student *current = hashTable[i];
-        while (current != NULL)
+        beginRollCall(store, subjectIndex, day - 1);
+    }
+    long marked = 0, failed = 0;
+    for (char *token = strtok_r(NULL, " \t,", saveptr); token != NULL;
+         token = strtok_r(NULL, " \t,", saveptr))
+    {
+        Student *student = resolveBatchStudent(store, token);
+        if (student)
         {
-            fprintf(file, "%-10d %-30s", current->id, current->name);
-            for (int day = minDay; day <= maxDay; day++)
-            {
-                if (current->subjects[subjectIndex].days[day - 1] == 1)
-                {
-                    fprintf(file, " P  ");
-                }
-                else
-                {
-                    fprintf(file, " A  ");
-                }
-            }
-            fprintf(file, "\n");
-            current = current->next;
+            markStudent(store, student, subjectIndex, day - 1, status);
+            marked++;
+        }
+        else
+        {
+            failed++;
         }
     }
-
-    fclose(file);
-    printf("Attendance report for %s generated successfully in %s\n", subject, filename);
+    printf("Marked %ld students %s for %s on day %d", marked, status ? "present" : "absent",
+           subject, day);
+    printf(failed ? " (%ld not found)\n" : "\n", failed);
+    return failed ? -1 : 0;
 }
 
-void viewAttendance()
+// Runs one batch command; returns 0 on success, -1 on failure and 1 for quit.
+int executeBatchCommand(AttendanceStore *store, char *line)
 {
-    int id;
-    printf("Enter student ID to view attendance: ");
-    if (scanf("%d", &id) != 1)
+    char *saveptr;
+    char *command = strtok_r(line, " \t", &saveptr);
+    if (!command || command[0] == '#')
     {
-        printf("Error: Invalid input for ID.\n");
-        return;
+        return 0;
     }
 
-    Student *student = searchStudentById(id);
-    if (!student)
+    if (strcmp(command, "load") == 0)
     {
-        printf("Student with ID %d not found.\n", id);
-        return;
+        char *file = strtok_r(NULL, " \t", &saveptr);
+        if (!file)
+        {
+            printf("Error: Usage: load FILE\n");
+            return -1;
+        }
+        loadStudentsFromFile(store, file);
+        return 0;
     }
-
-    printf("\nAttendance for %s (ID: %d):\n", student->name, student->id);
-    printf("=============================================================================================\n");
-
-    for (int part = 0; part < 3; part++)
+    if (strcmp(command, "insert") == 0)
     {
-        int startDay = part * 10 + 1;
-        int endDay = (part == 2) ? MAX_DAYS : startDay + 9;
-
-        printf("| " BOLD BLUE "%-15s" RESET, "Subject");
-        for (int day = startDay; day <= endDay; day++)
+        char *idToken = strtok_r(NULL, " \t", &saveptr);
+        char *name = saveptr;
+        while (name && (*name == ' ' || *name == '\t'))
         {
-            printf("| " BOLD BLUE "Day%-2d " RESET, day);
+            name++;
         }
-        printf("|\n");
-        printf("-----------------------------------------------------------------------------------------------\n");
+        if (!idToken || !name || *name == '\0')
+        {
+            printf("Error: Usage: insert ID NAME\n");
+            return -1;
+        }
+        int id;
+        if (parseBatchInt(idToken, "student ID", &id) != 0)
+        {
+            return -1;
+        }
+        if (findStudent(store, id))
+        {
+            printf("Error: Student with ID %d already exists.\n", id);
+            return -1;
+        }
+        char trimmed[MAX_NAME_LEN];
+        snprintf(trimmed, sizeof(trimmed), "%s", name);
+        insertStudent(store, id, trimmed);
+        journalInsert(store, id, trimmed);
+        printf("Student %d added successfully.\n", id);
+        return 0;
+    }
+    if (strcmp(command, "delete") == 0)
+    {
+        char *idToken = strtok_r(NULL, " \t", &saveptr);
+        int id;
+        if (!idToken)
+        {
+            printf("Error: Usage: delete ID\n");
+            return -1;
+        }
+        if (parseBatchInt(idToken, "student ID", &id) != 0)
+        {
+            return -1;
+        }
+        deleteStudentById(store, id);
+        return 0;
+    }
+    if (strcmp(command, "search") == 0 || strcmp(command, "view") == 0)
+    {
+        char *idToken = strtok_r(NULL, " \t", &saveptr);
+        Student *student = idToken ? resolveBatchStudent(store, idToken) : NULL;
+        if (!student)
+        {
+            return -1;
+        }
+        if (command[0] == 's')
+        {
+            printf("%d,%s\n", student->id, student->name);
+        }
+        else
+        {
+            printAttendance(store, student, 0);
+        }
+        return 0;
+    }
+    if (strcmp(command, "mark") == 0 || strcmp(command, "present") == 0 ||
+        strcmp(command, "absent") == 0)
+    {
+        return batchMark(store, command, &saveptr);
+    }
+    if (strcmp(command, "import") == 0)
+    {
+        char *file = strtok_r(NULL, " \t", &saveptr);
+        if (!file)
+        {
+            printf("Error: Usage: import FILE\n");
+            return -1;
+        }
+        importAttendance(store, file);
+        return 0;
+    }
+    if (strcmp(command, "report") == 0 || strcmp(command, "reports") == 0)
+    {
+        int combined = strcmp(command, "report") == 0;
+        char *list = strtok_r(NULL, " \t", &saveptr);
+        char *target = strtok_r(NULL, " \t", &saveptr);
+        char *formatName = strtok_r(NULL, " \t", &saveptr);
+        if (!list || !target)
+        {
+            printf("Error: Usage: %s SUBJECT[,SUBJECT...]|all %s [text|csv|json]\n", command,
+                   combined ? "FILE" : "PREFIX");
+            return -1;
+        }
+        int format = formatName ? parseReportFormat(formatName) : REPORT_TEXT;
+        int subjects[MAX_SUBJECTS];
+        int count = format < 0 ? -1 : parseSubjectSelection(store, list, subjects);
+        if (count < 0)
+        {
+            return -1;
+        }
+        return generateReports(store, subjects, count, target, combined, format);
+    }
+    if (strcmp(command, "save") == 0)
+    {
+        char *file = strtok_r(NULL, " \t", &saveptr);
+        if (!file)
+        {
+            printf("Error: Usage: save FILE\n");
+            return -1;
+        }
+        return saveSnapshot(store, file);
+    }
+    if (strcmp(command, "below") == 0)
+    {
+        char *thresholdToken = strtok_r(NULL, " \t", &saveptr);
+        char *subject = strtok_r(NULL, " \t", &saveptr);
+        char *file = strtok_r(NULL, " \t", &saveptr);
+        char *formatName = strtok_r(NULL, " \t", &saveptr);
+        if (!thresholdToken)
+        {
+            printf("Error: Usage: below PERCENT [SUBJECT|all] [FILE [text|csv|json]]\n");
+            return -1;
+        }
+        int threshold;
+        if (parseBatchInt(thresholdToken, "threshold", &threshold) != 0)
+        {
+            return -1;
+        }
+        int format = formatName ? parseReportFormat(formatName) : REPORT_TEXT;
+        if (format < 0)
+        {
+            return -1;
+        }
+        return reportStudentsBelow(store, threshold, subject, file, format, 0);
+    }
+    if (strcmp(command, "top") == 0 || strcmp(command, "bottom") == 0)
+    {
+        char *countToken = strtok_r(NULL, " \t", &saveptr);
+        char *subject = strtok_r(NULL, " \t", &saveptr);
+        char *file = strtok_r(NULL, " \t", &saveptr);
+        char *formatName = strtok_r(NULL, " \t", &saveptr);
+        if (!countToken)
+        {
+            printf("Error: Usage: %s K [SUBJECT|all] [FILE [text|csv|json]]\n", command);
+            return -1;
+        }
+        int k;
+        if (parseBatchInt(countToken, "K", &k) != 0)
+        {
+            return -1;
+        }
+        int format = formatName ? parseReportFormat(formatName) : REPORT_TEXT;
+        if (format < 0)
+        {
+            return -1;
+        }
+        return reportRanking(store, k, strcmp(command, "top") == 0, subject, file, format, 0);
+    }
+    if (strcmp(command, "find") == 0)
+    {
+        if (*saveptr == '\0')
+        {
+            printf("Error: Usage: find NAME-PREFIX\n");
+            return -1;
+        }
+        return searchStudentsByName(store, saveptr);
+    }
+    if (strcmp(command, "range") == 0)
+    {
+        char *first = strtok_r(NULL, " \t", &saveptr);
+        char *second = strtok_r(NULL, " \t", &saveptr);
+        int low, high;
+        if (!first || parseIdRange(first, second, &low, &high) != 0)
+        {
+            printf("Error: Usage: range LOW HIGH, or range PATTERN such as 5900115xx\n");
+            return -1;
+        }
+        return listStudentsInRange(store, low, high);
+    }
+    if (strcmp(command, "stats") == 0)
+    {
+        printMemoryStats(store);
+        return 0;
+    }
+    if (strcmp(command, "quit") == 0 || strcmp(command, "exit") == 0)
+    {
+        return 1;
+    }
+    printf("Error: Unknown command %s\n", command);
+    return -1;
+}
 
-        for (int i = 0; i < subjectCount; i++)
+// Reads commands from `input` one per line, without prompts or colours. Returns the number of
+// commands that failed.
+int runBatch(AttendanceStore *store, FILE *input)
+{
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    long lineNumber = 0;
+    int failures = 0;
+    while ((length = getline(&line, &capacity, input)) != -1)
+    {
+        lineNumber++;
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
         {
-            printf("| " BOLD BLUE "%-15s" RESET, subjectList[i]);
-            for (int day = startDay - 1; day < endDay; day++)
-            {
-                if (student->subjects[i].days[day] == -1)
-                {
-                    printf("| %-5s ", "NULL");
-                }
-                else if (student->subjects[i].days[day] == 1)
-                {
-                    printf("| " GREEN "P" RESET "   ");
-                }
-                else
-                {
-                    printf("| " RED "A" RESET "   ");
-                }
-            }
-            printf("|\n");
+            line[--length] = '\0';
+        }
+        int result = executeBatchCommand(store, line);
+        if (result == 1)
+        {
+            break;
+        }
+        if (result != 0)
+        {
+            printf("Error: Command on line %ld failed\n", lineNumber);
+            failures++;
         }
-        printf("----------------------------------------------------------------------------------------------\n");
     }
+    free(line);
+    journalCommit(store);
+    return failures;
+}
 
-    int percentage = total_percentage(student);
-    printf("\nTotal Attendance Percentage: %d%%\n", percentage);
+// The store being served; SIGINT and SIGTERM stop its server.
+static AttendanceStore *servedStore = NULL;
+
+static void stopServedStore(int signal)
+{
+    (void) signal;
+    stopServer(servedStore);
 }
 
-void printColoredMessage(const char *message, const char *color)
+// Runs server mode until SIGINT or SIGTERM, then puts the previous handlers back.
+int serveStore(AttendanceStore *store, const char *socketPath)
 {
-    printf("%s%s%s\n", color, message, RESET);
+#if HAVE_POSIX
+    struct sigaction action, previousInterrupt, previousTerminate;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stopServedStore;
+    sigemptyset(&action.sa_mask);
+    servedStore = store;
+    sigaction(SIGINT, &action, &previousInterrupt);
+    sigaction(SIGTERM, &action, &previousTerminate);
+    int failed = runServer(store, socketPath, resolveThreadCount(store));
+    sigaction(SIGINT, &previousInterrupt, NULL);
+    sigaction(SIGTERM, &previousTerminate, NULL);
+    servedStore = NULL;
+    return failed;
+#else
+    return runServer(store, socketPath, resolveThreadCount(store));
+#endif
 }
 
-void freeHashTable()
+// --generate roster FILE STUDENTS [seed]
+// --generate marks FILE STUDENTS MARKS [subjects] [seed]
+int runGenerator(int argc, char *argv[])
 {
-    for (int i = 0; i < TABLE_SIZE; i++)
+    int roster = argc >= 3 && strcmp(argv[0], "roster") == 0;
+    int marksMode = argc >= 4 && strcmp(argv[0], "marks") == 0;
+    int students = argc >= 3 ? atoi(argv[2]) : 0;
+    long marks = marksMode ? atol(argv[3]) : 0;
+    int subjects = marksMode && argc > 4 ? atoi(argv[4]) : MAX_SUBJECTS;
+    int seedArg = roster ? 3 : 5;
+    uint32_t seed = argc > seedArg ? (uint32_t) strtoul(argv[seedArg], NULL, 10)
+                                   : GENERATOR_DEFAULT_SEED;
+    if ((!roster && !marksMode) || (marksMode && (marks <= 0 || subjects < 1 ||
+                                                  subjects > MAX_SUBJECTS)))
+    {
+        printf("Error: Usage: --generate roster FILE STUDENTS [seed]\n"
+               "              --generate marks FILE STUDENTS MARKS [subjects] [seed]\n");
+        return 1;
+    }
+    seed = seed ? seed : GENERATOR_DEFAULT_SEED; // xorshift never leaves zero
+
+    double start = nowSeconds();
+    if (roster)
     {
-        Student *current = hashTable[i];
-        while (current != NULL)
+        RosterStats stats;
+        if (writeGeneratedRoster(argv[1], students, seed, &stats) != 0)
         {
-            Student *temp = current;
-            current = current->next;
-            free(temp);
+            return 1;
         }
-        hashTable[i] = NULL;
+        printf("Wrote %d students to %s in %.2f s\n", students, argv[1], nowSeconds() - start);
+        printf("  IDs   : %d to %d in %d cohorts\n", stats.firstId, stats.lastId,
+               (stats.lastId - stats.firstId) / ID_SUFFIX_SLOTS + 1);
+        printf("  suffix: %ld students share their last four digits, up to %d per suffix\n",
+               stats.sharedSuffixes, stats.longestSuffixChain);
+        printf("  names : %d to %d characters, %.1f on average\n", stats.shortestName,
+               stats.longestName, stats.meanName);
+        return 0;
+    }
+    if (writeGeneratedMarks(argv[1], students, marks, subjects, seed) != 0)
+    {
+        return 1;
     }
+    printf("Wrote %ld marks for %d students in %d subjects to %s in %.2f s\n", marks, students,
+           subjects, argv[1], nowSeconds() - start);
+    return 0;
 }
 
-int main()
+int main(int argc, char *argv[])
 {
     int choice;
-    char inputFile[100], reportFile[100], subject[MAX_NAME_LEN];
+    char inputFile[100], reportFile[100];
+    const char *snapshotPath = DEFAULT_SNAPSHOT_FILE;
+    const char *journalPath = DEFAULT_JOURNAL_FILE;
+    const char *batchFile = NULL;
+    const char *socketPath = NULL;
+    const char *reportDir = DEFAULT_REPORT_DIR;
+    int useJournal = 1;
+    int threads = 0;
+
+    for (int arg = 1; arg < argc; arg++)
+    {
+        if (strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc)
+        {
+            threads = atoi(argv[++arg]);
+        }
+        else if (strcmp(argv[arg], "--snapshot") == 0 && arg + 1 < argc)
+        {
+            snapshotPath = argv[++arg];
+        }
+        else if (strcmp(argv[arg], "--journal") == 0 && arg + 1 < argc)
+        {
+            journalPath = argv[++arg];
+        }
+        else if (strcmp(argv[arg], "--no-journal") == 0)
+        {
+            useJournal = 0;
+        }
+        else if (strcmp(argv[arg], "--batch") == 0 && arg + 1 < argc)
+        {
+            batchFile = argv[++arg];
+        }
+        else if (strcmp(argv[arg], "--serve") == 0)
+        {
+            int hasPath = arg + 1 < argc && argv[arg + 1][0] != '-';
+            socketPath = hasPath ? argv[++arg] : DEFAULT_SOCKET_FILE;
+        }
+        else if (strcmp(argv[arg], "--reports") == 0 && arg + 1 < argc)
+        {
+            reportDir = argv[++arg];
+        }
+        else if (strcmp(argv[arg], "--generate") == 0)
+        {
+            return runGenerator(argc - arg - 1, argv + arg + 1);
+        }
+        else
+        {
+            printf("Error: Unknown option %s\n", argv[arg]);
+            return 1;
+        }
+    }
+
+    AttendanceStore *store = createStore();
+    store->workerThreads = threads;
+    if (useJournal)
+    {
+        if (recoverState(store, snapshotPath, journalPath) != 0)
+        {
+            destroyStore(store);
+            return 1;
+        }
+    }
+    else
+    {
+        FILE *existing = fopen(snapshotPath, "rb");
+        if (existing)
+        {
+            fclose(existing);
+            loadSnapshot(store, snapshotPath);
+        }
+    }
+
+    if (socketPath)
+    {
+        snprintf(store->server.reportDir, sizeof(store->server.reportDir), "%s", reportDir);
+        int failed = serveStore(store, socketPath);
+        checkpointState(store);
+        destroyStore(store);
+        return failed ? 1 : 0;
+    }
+
+    if (batchFile)
+    {
+        FILE *input = strcmp(batchFile, "-") == 0 ? stdin : fopen(batchFile, "r");
+        if (!input)
+        {
+            printf("Error: Could not open file %s\n", batchFile);
+            destroyStore(store);
+            return 1;
+        }
+        int failures = runBatch(store, input);
+        if (input != stdin)
+        {
+            fclose(input);
+        }
+        checkpointState(store);
+        destroyStore(store);
+        return failures ? 1 : 0;
+    }
 
     while (1)
     {
+        journalCommit(store);
         printf("\n" BOLD CYAN "Attendance Management System" RESET "\n");
         printf(BLUE "1. Load Students from File\n" RESET);
         printf(BLUE "2. Generate Attendance Report\n" RESET);
@@ -433,11 +763,26 @@ int main()
         printf(BLUE "6. Mark Attendance\n" RESET);
         printf(BLUE "7. View Attendance\n" RESET);
         printf(BLUE "8. Exit\n" RESET);
+        printf(BLUE "9. Memory Statistics\n" RESET);
+        printf(BLUE "10. Save Snapshot\n" RESET);
+        printf(BLUE "11. Load Snapshot\n" RESET);
+        printf(BLUE "12. Import Attendance from File\n" RESET);
+        printf(BLUE "13. Students Below Threshold\n" RESET);
+        printf(BLUE "14. Rank Students by Attendance\n" RESET);
+        printf(BLUE "15. Search Student by Name\n" RESET);
+        printf(BLUE "16. List Students by ID Range\n" RESET);
         printf(YELLOW "Enter your choice: " RESET);
-        if (scanf("%d", &choice) != 1)
+        int scanned = scanf("%d", &choice);
+        if (scanned == EOF)
         {
+            // Closed input ends the session the same way Exit does
+            choice = 8;
+        }
+        else if (scanned != 1)
+        {
+            int c;
             printColoredMessage("Error: Invalid input. Please enter a number.", RED);
-            while (getchar() != '\n')
+            while ((c = getchar()) != '\n' && c != EOF)
                 ;
             continue;
         }
@@ -447,15 +792,26 @@ int main()
             case 1:
                 printf(YELLOW "Enter input file name: " RESET);
                 scanf("%s", inputFile);
-                loadStudentsFromFile(inputFile);
+                loadStudentsFromFile(store, inputFile);
                 break;
             case 2:
-                printf(YELLOW "Enter the subject name: " RESET);
-                scanf("%s", subject);
+            {
+                int subjects[MAX_SUBJECTS];
+                char subjectNames[MAX_SUBJECTS * MAX_NAME_LEN], formatName[10];
+                printf(YELLOW "Enter subject names (comma-separated, or all): " RESET);
+                scanf("%499s", subjectNames);
                 printf(YELLOW "Enter report file name: " RESET);
                 scanf("%s", reportFile);
-                generateReport(reportFile, subject);
+                printf(YELLOW "Enter report format (text, csv, json): " RESET);
+                scanf("%9s", formatName);
+                int format = parseReportFormat(formatName);
+                int count = format < 0 ? -1 : parseSubjectSelection(store, subjectNames, subjects);
+                if (count > 0)
+                {
+                    generateReports(store, subjects, count, reportFile, 1, format);
+                }
                 break;
+            }
             case 3:
             {
                 int id;
@@ -465,13 +821,18 @@ int main()
                     printColoredMessage("Error: Invalid input for ID.", RED);
                     break;
                 }
-                Student *student = searchStudentById(id);
+                int matches;
+                Student *student = lookupStudent(store, id, &matches);
                 if (student)
                 {
                     printColoredMessage("Student found:", GREEN);
                     printf(GREEN "ID: %d\n" RESET, student->id);
                     printf(GREEN "Name: %s\n" RESET, student->name);
                 }
+                else if (matches > 1)
+                {
+                    printSuffixMatches(store, id);
+                }
                 else
                 {
                     printColoredMessage("Student with ID not found.", RED);
@@ -487,7 +848,7 @@ int main()
                     printColoredMessage("Error: Invalid input for ID.", RED);
                     break;
                 }
-                deleteStudentById(id);
+                deleteStudentById(store, id);
                 break;
             }
             case 5:
@@ -510,26 +871,127 @@ int main()
                 }
                 name[strcspn(name, "\n")] = '\0';
 
-                if (searchStudentById(id))
+                if (findStudent(store, id))
                 {
                     printColoredMessage("Error: Student with ID already exists.", RED);
                     break;
                 }
 
-                insertStudent(id, name);
+                insertStudent(store, id, name);
+                journalInsert(store, id, name);
                 printColoredMessage("Student added successfully.", GREEN);
                 break;
             }
             case 6:
-                markAttendance();
+                markAttendance(store);
                 break;
             case 7:
-                viewAttendance();
+                viewAttendance(store);
                 break;
             case 8:
-                freeHashTable();
+                checkpointState(store);
+                destroyStore(store);
                 printColoredMessage("Exiting...", GREEN);
                 return 0;
+            case 9:
+                printMemoryStats(store);
+                break;
+            case 10:
+                printf(YELLOW "Enter snapshot file name: " RESET);
+                scanf("%s", inputFile);
+                if (saveSnapshot(store, inputFile) == 0)
+                {
+                    printColoredMessage("Snapshot saved successfully.", GREEN);
+                }
+                break;
+            case 11:
+                printf(YELLOW "Enter snapshot file name: " RESET);
+                scanf("%s", inputFile);
+                if (loadSnapshot(store, inputFile) == 0)
+                {
+                    printf(GREEN "Loaded %d students from snapshot %s\n" RESET,
+                           store->hashTable.count, inputFile);
+                    checkpointState(store);
+                }
+                break;
+            case 12:
+                printf(YELLOW "Enter attendance file name: " RESET);
+                scanf("%s", inputFile);
+                importAttendance(store, inputFile);
+                break;
+            case 13:
+            {
+                int threshold;
+                printf(YELLOW "Enter threshold percentage: " RESET);
+                if (scanf("%d", &threshold) != 1)
+                {
+                    printColoredMessage("Error: Invalid input for threshold.", RED);
+                    break;
+                }
+                printf(YELLOW "Enter subject name (or all): " RESET);
+                scanf("%s", inputFile);
+                reportStudentsBelow(store, threshold, inputFile, NULL, REPORT_TEXT, 1);
+                break;
+            }
+            case 14:
+            {
+                long k;
+                char order[10];
+                printf(YELLOW "Enter top or bottom: " RESET);
+                scanf("%9s", order);
+                if (strcmp(order, "top") != 0 && strcmp(order, "bottom") != 0)
+                {
+                    printColoredMessage("Error: Enter either top or bottom.", RED);
+                    break;
+                }
+                printf(YELLOW "Enter number of students: " RESET);
+                if (scanf("%ld", &k) != 1)
+                {
+                    printColoredMessage("Error: Invalid input for number of students.", RED);
+                    break;
+                }
+                printf(YELLOW "Enter subject name (or all): " RESET);
+                scanf("%s", inputFile);
+                reportRanking(store, k, strcmp(order, "top") == 0, inputFile, NULL, REPORT_TEXT,
+                              1);
+                break;
+            }
+            case 15:
+            {
+                char name[MAX_NAME_LEN];
+                printf(YELLOW "Enter the start of a name: " RESET);
+                getchar();
+                if (!fgets(name, sizeof(name), stdin))
+                {
+                    printColoredMessage("Error: Invalid input for name.", RED);
+                    break;
+                }
+                name[strcspn(name, "\n")] = '\0';
+                searchStudentsByName(store, name);
+                break;
+            }
+            case 16:
+            {
+                char range[2 * MAX_NAME_LEN];
+                printf(YELLOW "Enter ID range (LOW HIGH, or a pattern like 5900115xx): " RESET);
+                getchar();
+                if (!fgets(range, sizeof(range), stdin))
+                {
+                    printColoredMessage("Error: Invalid input for range.", RED);
+                    break;
+                }
+                char *saveptr;
+                char *first = strtok_r(range, " \t\n", &saveptr);
+                char *second = strtok_r(NULL, " \t\n", &saveptr);
+                int low, high;
+                if (!first || parseIdRange(first, second, &low, &high) != 0)
+                {
+                    printColoredMessage("Error: Invalid ID range.", RED);
+                    break;
+                }
+                listStudentsInRange(store, low, high);
+                break;
+            }
             default:
                 printColoredMessage("Invalid choice. Try again.", RED);
         }